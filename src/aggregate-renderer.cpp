@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstring>
+
+#include "aggregate-renderer.hpp"
+#include "spoke-kernel.hpp"
+
+char const *aggregationName(Aggregation mode) noexcept {
+  switch (mode) {
+    case Aggregation::Max: return "max";
+    case Aggregation::Mean: return "mean";
+    default: return "last";
+  }
+}
+
+bool parseAggregation(std::string const &name, Aggregation &mode) noexcept {
+  for (Aggregation candidate : {Aggregation::Last, Aggregation::Max, Aggregation::Mean}) {
+    if (name == aggregationName(candidate)) {
+      mode = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+FanInTable::FanInTable(ScanTable const &table) noexcept
+  : m_spokes(table.spokes())
+  , m_bins(table.bins())
+  , m_fanIn(table.valid() ? table.canvasSize() / 4 : 0, 0)
+  , m_maxFanIn(0)
+  , m_runBegin(table.spokes() + 1u, 0)
+  , m_runs()
+  , m_sharedBegin(table.spokes() + 1u, 0)
+  , m_shared()
+  , m_offsets()
+  , m_sourceBegin()
+  , m_sources() {
+  if (!table.valid()) return;
+  //Bins past the reach of a table scaled for a range are not drawn.
+  uint32_t const reach = table.reach();
+
+  for (uint32_t spoke = 0; spoke < m_spokes; spoke++) {
+    uint32_t const *offsets = table.spoke(spoke);
+    for (uint32_t bin = 0; bin < reach; bin++) {
+      uint16_t &count = m_fanIn[offsets[bin] / 4];
+      if (count < 0xffff) count++;
+    }
+  }
+
+  //Shared pixels are numbered in canvas order, and their samples gathered in spoke and bin order.
+  uint32_t const pixels = uint32_t(m_fanIn.size());
+  std::vector<uint32_t> index(pixels, 0);
+  m_sourceBegin.push_back(0);
+  for (uint32_t pixel = 0; pixel < pixels; pixel++) {
+    m_maxFanIn = std::max<uint32_t>(m_maxFanIn, m_fanIn[pixel]);
+    if (m_fanIn[pixel] < 2) continue;
+    index[pixel] = uint32_t(m_offsets.size());
+    m_offsets.push_back(pixel * 4);
+    m_sourceBegin.push_back(m_sourceBegin.back() + m_fanIn[pixel]);
+  }
+  m_sources.resize(m_sourceBegin.back());
+  std::vector<uint32_t> filled(m_offsets.size(), 0);
+  //Spoke that last listed each shared pixel, so a spoke lists it once.
+  std::vector<uint32_t> listedBy(m_offsets.size(), 0xffffffff);
+
+  for (uint32_t spoke = 0; spoke < m_spokes; spoke++) {
+    m_runBegin[spoke] = uint32_t(m_runs.size() / 2);
+    m_sharedBegin[spoke] = uint32_t(m_shared.size());
+    uint32_t const *offsets = table.spoke(spoke);
+    bool inRun = false;
+    for (uint32_t bin = 0; bin < reach; bin++) {
+      uint32_t const pixel = offsets[bin] / 4;
+      bool const own = m_fanIn[pixel] == 1;
+      if (own != inRun) m_runs.push_back(uint16_t(bin));
+      inRun = own;
+      if (own) continue;
+      uint32_t const shared = index[pixel];
+      m_sources[m_sourceBegin[shared] + filled[shared]++] = spoke * m_bins + bin;
+      if (listedBy[shared] != spoke) {
+        listedBy[shared] = spoke;
+        m_shared.push_back(shared);
+      }
+    }
+    if (inRun) m_runs.push_back(uint16_t(reach));
+  }
+  m_runBegin[m_spokes] = uint32_t(m_runs.size() / 2);
+  m_sharedBegin[m_spokes] = uint32_t(m_shared.size());
+}
+
+uint16_t FanInTable::spokes() const noexcept {
+  return m_spokes;
+}
+
+uint16_t FanInTable::bins() const noexcept {
+  return m_bins;
+}
+
+uint32_t FanInTable::fanIn(uint32_t offset) const noexcept {
+  return m_fanIn[offset / 4];
+}
+
+uint32_t FanInTable::maxFanIn() const noexcept {
+  return m_maxFanIn;
+}
+
+uint32_t FanInTable::runCount(uint32_t spoke) const noexcept {
+  return m_runBegin[spoke + 1] - m_runBegin[spoke];
+}
+
+uint16_t const *FanInTable::runs(uint32_t spoke) const noexcept {
+  return m_runs.data() + m_runBegin[spoke] * 2;
+}
+
+uint32_t FanInTable::sharedCount(uint32_t spoke) const noexcept {
+  return m_sharedBegin[spoke + 1] - m_sharedBegin[spoke];
+}
+
+uint32_t const *FanInTable::shared(uint32_t spoke) const noexcept {
+  return m_shared.data() + m_sharedBegin[spoke];
+}
+
+uint32_t FanInTable::sharedPixels() const noexcept {
+  return uint32_t(m_offsets.size());
+}
+
+uint32_t FanInTable::offset(uint32_t pixel) const noexcept {
+  return m_offsets[pixel];
+}
+
+uint32_t FanInTable::sourceCount(uint32_t pixel) const noexcept {
+  return m_sourceBegin[pixel + 1] - m_sourceBegin[pixel];
+}
+
+uint32_t const *FanInTable::sources(uint32_t pixel) const noexcept {
+  return m_sources.data() + m_sourceBegin[pixel];
+}
+
+AggregateRenderer::AggregateRenderer(ScanTable const &table, Aggregation mode) noexcept
+  : m_table(table)
+  , m_ownFanIn(new FanInTable{table})
+  , m_fanIn(*m_ownFanIn)
+  , m_mode(mode)
+  , m_touched(m_fanIn.sharedPixels(), 0) {
+}
+
+AggregateRenderer::AggregateRenderer(ScanTable const &table, FanInTable const &fanIn, Aggregation mode) noexcept
+  : m_table(table)
+  , m_ownFanIn()
+  , m_fanIn(fanIn)
+  , m_mode(mode)
+  , m_touched(m_fanIn.sharedPixels(), 0) {
+}
+
+Aggregation AggregateRenderer::mode() const noexcept {
+  return m_mode;
+}
+
+FanInTable const &AggregateRenderer::fanIn() const noexcept {
+  return m_fanIn;
+}
+
+void AggregateRenderer::scatterRuns(PolarBuffer const &polar, uint32_t spoke, Palette const &palette, char *canvas) noexcept {
+  ScatterKernel const kernel = scatterKernel();
+  uint32_t const *offsets = m_table.spoke(spoke);
+  uint8_t const *row = polar.row(spoke);
+  uint16_t const *runs = m_fanIn.runs(spoke);
+  for (uint32_t i = 0; i < m_fanIn.runCount(spoke); i++) {
+    uint32_t const begin = runs[2 * i];
+    uint32_t const end = runs[2 * i + 1];
+    kernel(canvas, offsets + begin, row + begin, end - begin, palette.argb);
+  }
+  uint32_t const *shared = m_fanIn.shared(spoke);
+  for (uint32_t i = 0; i < m_fanIn.sharedCount(spoke); i++) {
+    if (m_touched[shared[i]] != 0) continue;
+    m_touched[shared[i]] = 1;
+    m_pending.push_back(shared[i]);
+  }
+}
+
+void AggregateRenderer::writeShared(PolarBuffer const &polar, Palette const &palette, char *canvas) noexcept {
+  uint8_t const *strengths = polar.data();
+  for (uint32_t pixel : m_pending) {
+    uint32_t const *sources = m_fanIn.sources(pixel);
+    uint32_t const count = m_fanIn.sourceCount(pixel);
+    uint32_t strength = 0;
+    if (m_mode == Aggregation::Max) {
+      for (uint32_t i = 0; i < count; i++) strength = std::max<uint32_t>(strength, strengths[sources[i]]);
+    } else if (m_mode == Aggregation::Mean) {
+      for (uint32_t i = 0; i < count; i++) strength += strengths[sources[i]];
+      strength = (strength + count / 2) / count;
+    } else {
+      strength = strengths[sources[count - 1]];
+    }
+    std::memcpy(canvas + m_fanIn.offset(pixel), &palette.argb[strength], 4);
+    m_touched[pixel] = 0;
+  }
+  m_pending.clear();
+}
+
+uint32_t AggregateRenderer::renderDirty(PolarBuffer &polar, Palette const &palette, char *canvas) noexcept {
+  uint32_t rendered = 0;
+  for (uint32_t spoke = 0; spoke < polar.spokes() && polar.dirtyCount() > 0; spoke++) {
+    if (polar.dirty(spoke)) {
+      scatterRuns(polar, spoke, palette, canvas);
+      polar.clearDirty(spoke);
+      rendered++;
+    }
+  }
+  writeShared(polar, palette, canvas);
+  return rendered;
+}
+
+uint32_t AggregateRenderer::renderAll(PolarBuffer &polar, Palette const &palette, char *canvas) noexcept {
+  for (uint32_t spoke = 0; spoke < polar.spokes(); spoke++) {
+    scatterRuns(polar, spoke, palette, canvas);
+    polar.clearDirty(spoke);
+  }
+  writeShared(polar, palette, canvas);
+  return polar.spokes();
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AGGREGATE_RENDERER
+#define AGGREGATE_RENDERER
+
+#include "palette.hpp"
+#include "polar-buffer.hpp"
+#include "scan-table.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//How the samples landing on one pixel are combined.
+enum class Aggregation {
+  //The sample of the highest spoke and bin, as a full render in spoke order.
+  Last,
+  Max,
+  Mean
+};
+
+char const *aggregationName(Aggregation mode) noexcept;
+bool parseAggregation(std::string const &name, Aggregation &mode) noexcept;
+
+//Fan-in of a scan table. Near the origin many samples, from neighbouring spokes and from consecutive bins of one spoke,
+//map to the same pixel. For every spoke the table keeps the runs of bins whose pixel no other sample maps to, and the
+//shared pixels it covers, each listed once; for every shared pixel it keeps the samples that map to it.
+class FanInTable {
+ public:
+  FanInTable(ScanTable const &table) noexcept;
+
+  uint16_t spokes() const noexcept;
+  uint16_t bins() const noexcept;
+
+  //Samples mapped to the pixel at a canvas byte offset, saturating at 65535.
+  uint32_t fanIn(uint32_t offset) const noexcept;
+  uint32_t maxFanIn() const noexcept;
+
+  //Bins with a pixel of their own as runCount(spoke) pairs of first bin and one past the last bin.
+  uint32_t runCount(uint32_t spoke) const noexcept;
+  uint16_t const *runs(uint32_t spoke) const noexcept;
+
+  //Shared pixels covered by a spoke, as indices below sharedPixels().
+  uint32_t sharedCount(uint32_t spoke) const noexcept;
+  uint32_t const *shared(uint32_t spoke) const noexcept;
+
+  uint32_t sharedPixels() const noexcept;
+  //Canvas byte offset of a shared pixel.
+  uint32_t offset(uint32_t pixel) const noexcept;
+  //Samples of a shared pixel as spoke * bins() + bin, in spoke and bin order.
+  uint32_t sourceCount(uint32_t pixel) const noexcept;
+  uint32_t const *sources(uint32_t pixel) const noexcept;
+
+ private:
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  std::vector<uint16_t> m_fanIn;
+  uint32_t m_maxFanIn;
+  std::vector<uint32_t> m_runBegin;
+  std::vector<uint16_t> m_runs;
+  std::vector<uint32_t> m_sharedBegin;
+  std::vector<uint32_t> m_shared;
+  std::vector<uint32_t> m_offsets;
+  std::vector<uint32_t> m_sourceBegin;
+  std::vector<uint32_t> m_sources;
+};
+
+//Forward renderer that stores every pixel once per render. The runs of each dirty spoke are scattered as by
+//renderDirty, and each shared pixel covered by any dirty spoke is then written with the combined strength of all its
+//samples in the polar buffer.
+class AggregateRenderer {
+ private:
+  AggregateRenderer(const AggregateRenderer &) = delete;
+  AggregateRenderer(AggregateRenderer &&)      = delete;
+  AggregateRenderer &operator=(const AggregateRenderer &) = delete;
+  AggregateRenderer &operator=(AggregateRenderer &&) = delete;
+
+ public:
+  //The table must match the polar buffer geometry and fit the canvas.
+  AggregateRenderer(ScanTable const &table, Aggregation mode) noexcept;
+  //Renders with the fan-in of the table built elsewhere, so renderers of several images can share it. Both tables
+  //must outlive the renderer.
+  AggregateRenderer(ScanTable const &table, FanInTable const &fanIn, Aggregation mode) noexcept;
+
+  Aggregation mode() const noexcept;
+  FanInTable const &fanIn() const noexcept;
+
+  //As renderDirty and renderAll in renderer.hpp. Return the spokes rendered.
+  uint32_t renderDirty(PolarBuffer &polar, Palette const &palette, char *canvas) noexcept;
+  uint32_t renderAll(PolarBuffer &polar, Palette const &palette, char *canvas) noexcept;
+
+ private:
+  void scatterRuns(PolarBuffer const &polar, uint32_t spoke, Palette const &palette, char *canvas) noexcept;
+  void writeShared(PolarBuffer const &polar, Palette const &palette, char *canvas) noexcept;
+
+  ScanTable const &m_table;
+  std::unique_ptr<FanInTable> m_ownFanIn;
+  FanInTable const &m_fanIn;
+  Aggregation m_mode;
+  //Shared pixels covered by the spokes of the render in progress.
+  std::vector<uint8_t> m_touched;
+  std::vector<uint32_t> m_pending{};
+};
+
+#endif
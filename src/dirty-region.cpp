@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstdint>
+
+#include "dirty-region.hpp"
+
+static Rect unite(Rect const &a, Rect const &b) noexcept {
+  uint32_t const x0 = std::min(a.x, b.x);
+  uint32_t const y0 = std::min(a.y, b.y);
+  uint32_t const x1 = std::max(uint32_t(a.x) + a.width, uint32_t(b.x) + b.width);
+  uint32_t const y1 = std::max(uint32_t(a.y) + a.height, uint32_t(b.y) + b.height);
+  Rect r;
+  r.x = uint16_t(x0);
+  r.y = uint16_t(y0);
+  r.width = uint16_t(x1 - x0);
+  r.height = uint16_t(y1 - y0);
+  return r;
+}
+
+static uint64_t areaOf(Rect const &r) noexcept {
+  return uint64_t(r.width) * r.height;
+}
+
+SpokeBounds::SpokeBounds(ScanTable const &table, uint16_t margin) noexcept
+  : m_bounds(table.spokes()) {
+  uint32_t const width = table.width();
+  for (uint32_t spoke = 0; spoke < table.spokes() && table.valid(); spoke++) {
+    uint32_t const *offsets = table.spoke(spoke);
+    uint32_t x0 = table.width();
+    uint32_t y0 = table.height();
+    uint32_t x1 = 0;
+    uint32_t y1 = 0;
+    for (uint32_t bin = 0; bin < table.reach(); bin++) {
+      uint32_t const pixel = offsets[bin] / 4;
+      uint32_t const x = pixel % width;
+      uint32_t const y = pixel / width;
+      x0 = std::min(x0, x);
+      y0 = std::min(y0, y);
+      x1 = std::max(x1, x);
+      y1 = std::max(y1, y);
+    }
+    x0 = (x0 > margin) ? x0 - margin : 0;
+    y0 = (y0 > margin) ? y0 - margin : 0;
+    x1 = std::min(x1 + margin, uint32_t(table.width()) - 1);
+    y1 = std::min(y1 + margin, uint32_t(table.height()) - 1);
+    Rect &r = m_bounds[spoke];
+    r.x = uint16_t(x0);
+    r.y = uint16_t(y0);
+    r.width = uint16_t(x1 - x0 + 1);
+    r.height = uint16_t(y1 - y0 + 1);
+  }
+}
+
+uint16_t SpokeBounds::spokes() const noexcept {
+  return uint16_t(m_bounds.size());
+}
+
+Rect const &SpokeBounds::bounds(uint32_t spoke) const noexcept {
+  return m_bounds[spoke];
+}
+
+DirtyRegion::DirtyRegion(SpokeBounds const &bounds, uint32_t maxRects) noexcept
+  : m_bounds(bounds)
+  , m_maxRects((maxRects == 0) ? 1 : maxRects) {
+  m_rects.reserve(m_maxRects + 1);
+}
+
+void DirtyRegion::add(uint32_t spoke) noexcept {
+  Rect const &r = m_bounds.bounds(spoke);
+  bool const adjacent = m_lastSpoke >= 0 && (spoke == uint32_t(m_lastSpoke) || spoke == (uint32_t(m_lastSpoke) + 1) % m_bounds.spokes());
+  m_lastSpoke = spoke;
+  if (adjacent && !m_rects.empty()) {
+    m_rects.back() = unite(m_rects.back(), r);
+    return;
+  }
+  m_rects.push_back(r);
+  if (m_rects.size() <= m_maxRects) return;
+
+  //Too many rectangles: merge the pair whose union adds the least area. Overlapping pairs can add less than nothing.
+  int64_t best = INT64_MAX;
+  uint32_t bestA = 0;
+  uint32_t bestB = 1;
+  for (uint32_t a = 0; a < m_rects.size(); a++) {
+    for (uint32_t b = a + 1; b < m_rects.size(); b++) {
+      int64_t const growth = int64_t(areaOf(unite(m_rects[a], m_rects[b]))) - int64_t(areaOf(m_rects[a])) - int64_t(areaOf(m_rects[b]));
+      if (growth < best) {
+        best = growth;
+        bestA = a;
+        bestB = b;
+      }
+    }
+  }
+  m_rects[bestA] = unite(m_rects[bestA], m_rects[bestB]);
+  m_rects.erase(m_rects.begin() + bestB);
+}
+
+void DirtyRegion::clear() noexcept {
+  m_rects.clear();
+  m_lastSpoke = -1;
+}
+
+bool DirtyRegion::empty() const noexcept {
+  return m_rects.empty();
+}
+
+std::vector<Rect> const &DirtyRegion::rects() const noexcept {
+  return m_rects;
+}
+
+uint64_t DirtyRegion::area() const noexcept {
+  uint64_t total = 0;
+  for (auto const &r : m_rects) total += areaOf(r);
+  return total;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DIRTY_REGION
+#define DIRTY_REGION
+
+#include "scan-table.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//Rectangle of canvas pixels.
+struct Rect {
+  uint16_t x{0};
+  uint16_t y{0};
+  uint16_t width{0};
+  uint16_t height{0};
+};
+
+//Bounding box of the pixels of every spoke of a scan table, grown by margin pixels and clipped to the canvas. The
+//margin of 1 also covers pixels the inverse renderer fills from a spoke between its forward samples.
+class SpokeBounds {
+ public:
+  SpokeBounds(ScanTable const &table, uint16_t margin = 1) noexcept;
+
+  uint16_t spokes() const noexcept;
+  Rect const &bounds(uint32_t spoke) const noexcept;
+
+ private:
+  std::vector<Rect> m_bounds;
+};
+
+//Region of the canvas changed since it was last cleared, as a few rectangles. Consecutive spokes grow the same
+//rectangle, so a sector of spokes becomes one box; a jump starts a new one. Beyond maxRects the two rectangles whose
+//union adds the least area are merged.
+class DirtyRegion {
+ public:
+  DirtyRegion(SpokeBounds const &bounds, uint32_t maxRects = 8) noexcept;
+
+  void add(uint32_t spoke) noexcept;
+  void clear() noexcept;
+
+  bool empty() const noexcept;
+  std::vector<Rect> const &rects() const noexcept;
+
+  //Pixels covered by the rectangles, counting overlaps twice.
+  uint64_t area() const noexcept;
+
+ private:
+  SpokeBounds const &m_bounds;
+  uint32_t m_maxRects;
+  std::vector<Rect> m_rects{};
+  int64_t m_lastSpoke{-1};
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cmath>
+
+#include "frame-mailbox.hpp"
+
+void FrameMailbox::post(RadarFrameStatus const &status, uint32_t spoke, bool sweepComplete) noexcept {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ticket.spokes == 0) m_ticket.firstSpoke = uint16_t(spoke);
+    m_ticket.lastSpoke = uint16_t(spoke);
+    m_ticket.spokes++;
+    m_ticket.sweepComplete = m_ticket.sweepComplete || sweepComplete;
+    m_ticket.status = status;
+  }
+  if (sweepComplete) m_sweep.notify_one();
+}
+
+bool FrameMailbox::take(FrameTicket &ticket) noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_ticket.spokes == 0) return false;
+  ticket = m_ticket;
+  m_ticket.spokes = 0;
+  m_ticket.sweepComplete = false;
+  return true;
+}
+
+bool FrameMailbox::waitSweep(std::chrono::milliseconds timeout) noexcept {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_sweep.wait_for(lock, timeout, [this]() { return m_ticket.sweepComplete || m_closed; });
+  return m_ticket.sweepComplete;
+}
+
+void FrameMailbox::close() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+  }
+  m_sweep.notify_all();
+}
+
+FramePacing::FramePacing(std::chrono::microseconds period) noexcept
+  : m_period(period) {
+}
+
+void FramePacing::frame(std::chrono::steady_clock::time_point tick, std::chrono::steady_clock::time_point start,
+  std::chrono::steady_clock::time_point end) noexcept {
+  using ms = std::chrono::duration<double, std::milli>;
+  if (m_lastStart != std::chrono::steady_clock::time_point{}) {
+    double const interval = ms(start - m_lastStart).count();
+    m_intervals++;
+    m_intervalSum += interval;
+    m_intervalSquares += interval * interval;
+    m_stats.maxInterval = std::max(m_stats.maxInterval, interval);
+    m_stats.meanInterval = m_intervalSum / double(m_intervals);
+    double const variance = m_intervalSquares / double(m_intervals) - m_stats.meanInterval * m_stats.meanInterval;
+    m_stats.jitter = std::sqrt(std::max(variance, 0.0));
+  }
+  m_lastStart = start;
+  if (m_period.count() > 0 && start - tick > m_period / 2) m_stats.late++;
+
+  double const render = ms(end - start).count();
+  m_stats.frames++;
+  m_renderSum += render;
+  m_stats.meanRender = m_renderSum / double(m_stats.frames);
+  m_stats.maxRender = std::max(m_stats.maxRender, render);
+}
+
+void FramePacing::idle() noexcept {
+  m_stats.idle++;
+}
+
+FramePacingStats FramePacing::stats() const noexcept {
+  return m_stats;
+}
+
+void FramePacing::reset() noexcept {
+  m_stats = FramePacingStats{};
+  m_intervals = 0;
+  m_intervalSum = 0;
+  m_intervalSquares = 0;
+  m_renderSum = 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FRAME_MAILBOX
+#define FRAME_MAILBOX
+
+#include "radar-frame.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+//What changed in the radar image since the render thread last looked.
+struct FrameTicket {
+  RadarFrameStatus status{};
+  //Spokes written since the last take, in arrival order from firstSpoke to lastSpoke. A count of a revolution or
+  //more means the whole image.
+  uint16_t firstSpoke{0};
+  uint16_t lastSpoke{0};
+  uint32_t spokes{0};
+  //At least one sweep was completed since the last take.
+  bool sweepComplete{false};
+};
+
+//Single slot between the decode thread and the render thread. The decode thread posts every spoke into the slot and
+//never waits for the reader; the reader takes the newest state whenever it is ready for a frame, and any posts it
+//did not wake for are merged into that one.
+class FrameMailbox {
+ private:
+  FrameMailbox(const FrameMailbox &) = delete;
+  FrameMailbox(FrameMailbox &&)      = delete;
+  FrameMailbox &operator=(const FrameMailbox &) = delete;
+  FrameMailbox &operator=(FrameMailbox &&) = delete;
+
+ public:
+  FrameMailbox() = default;
+
+  void post(RadarFrameStatus const &status, uint32_t spoke, bool sweepComplete) noexcept;
+
+  //Empties the slot into ticket. False if nothing was posted since the last take.
+  bool take(FrameTicket &ticket) noexcept;
+
+  //Waits until a sweep is completed, close() is called or the timeout passes. True if a sweep is waiting.
+  bool waitSweep(std::chrono::milliseconds timeout) noexcept;
+
+  //Wakes the reader for shutdown.
+  void close() noexcept;
+
+ private:
+  std::mutex m_mutex{};
+  std::condition_variable m_sweep{};
+  FrameTicket m_ticket{};
+  bool m_closed{false};
+};
+
+//Frame pacing of the render thread, in milliseconds.
+struct FramePacingStats {
+  uint64_t frames{0};
+  //Wakeups with nothing new to draw.
+  uint64_t idle{0};
+  //Frames started more than half a period after their tick.
+  uint64_t late{0};
+  //Time between the starts of consecutive frames.
+  double meanInterval{0};
+  double jitter{0};
+  double maxInterval{0};
+  //Time from the start of a frame to the image being published and shown.
+  double meanRender{0};
+  double maxRender{0};
+};
+
+class FramePacing {
+ public:
+  //period is the target time between frames, 0 when frames follow the sweeps.
+  FramePacing(std::chrono::microseconds period) noexcept;
+
+  //A frame due at tick, started at start and finished at end.
+  void frame(std::chrono::steady_clock::time_point tick, std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end) noexcept;
+  void idle() noexcept;
+
+  FramePacingStats stats() const noexcept;
+  //Starts new statistics. The interval to the next frame is still measured from the last one.
+  void reset() noexcept;
+
+ private:
+  std::chrono::microseconds m_period;
+  std::chrono::steady_clock::time_point m_lastStart{};
+  FramePacingStats m_stats{};
+  uint64_t m_intervals{0};
+  double m_intervalSum{0};
+  double m_intervalSquares{0};
+  double m_renderSum{0};
+};
+
+#endif
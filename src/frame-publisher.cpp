@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <new>
+
+#include "frame-publisher.hpp"
+
+//Frames start on a page boundary after the header.
+static uint32_t const FRAME_DATA_OFFSET = 4096;
+static_assert(sizeof(RadarFrameHeader) <= FRAME_DATA_OFFSET, "header must fit before the frames");
+
+FramePublisher::FramePublisher(std::string const &name, uint16_t c_width, uint16_t c_height, uint32_t buffers) noexcept
+  : m_buffers((buffers < 2) ? 2 : ((buffers > RADAR_FRAME_MAX_BUFFERS) ? RADAR_FRAME_MAX_BUFFERS : buffers))
+  , m_frameBytes(uint32_t(c_width) * c_height * 4)
+  , m_shm(new cluon::SharedMemory{name, FRAME_DATA_OFFSET + m_buffers * m_frameBytes}) {
+  if (!m_shm->valid()) return;
+
+  RadarFrameHeader *h = new (m_shm->data()) RadarFrameHeader;
+  h->width = c_width;
+  h->height = c_height;
+  h->buffers = m_buffers;
+  h->frameBytes = m_frameBytes;
+  h->dataOffset = FRAME_DATA_OFFSET;
+  h->latest.store(0, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < RADAR_FRAME_MAX_BUFFERS; i++) {
+    h->slots[i].version.store(0, std::memory_order_relaxed);
+    h->slots[i].reserved = 0;
+    h->slots[i].sequence.store(0, std::memory_order_relaxed);
+    h->slots[i].timestamp.store(0, std::memory_order_relaxed);
+  }
+  h->seqlock.store(0, std::memory_order_relaxed);
+  writeFrameStatus(*h, RadarFrameStatus{});
+  //Readers check the magic first, so it is written last.
+  std::atomic_thread_fence(std::memory_order_release);
+  h->magic = RADAR_FRAME_MAGIC;
+}
+
+bool FramePublisher::valid() const noexcept {
+  return m_shm->valid();
+}
+
+uint32_t FramePublisher::buffers() const noexcept {
+  return m_buffers;
+}
+
+uint32_t FramePublisher::frameBytes() const noexcept {
+  return m_frameBytes;
+}
+
+uint64_t FramePublisher::publish(char const *image, int64_t timestamp) noexcept {
+  if (!valid()) return 0;
+  RadarFrameHeader *h = header();
+  uint32_t const index = (m_sequence == 0) ? 0 : (h->latest.load(std::memory_order_relaxed) + 1) % m_buffers;
+  RadarFrameSlot &slot = h->slots[index];
+
+  uint32_t const version = slot.version.load(std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(frame(index), image, m_frameBytes);
+  uint64_t const sequence = m_sequence + 1;
+  slot.sequence.store(sequence, std::memory_order_relaxed);
+  slot.timestamp.store(timestamp, std::memory_order_relaxed);
+
+  slot.version.store(version + 2, std::memory_order_release);
+  h->latest.store(index, std::memory_order_release);
+  m_sequence = sequence;
+  return sequence;
+}
+
+uint64_t FramePublisher::publish(char const *image, int64_t timestamp, RadarFrameStatus const &status) noexcept {
+  uint64_t const sequence = publish(image, timestamp);
+  if (sequence != 0) {
+    RadarFrameStatus published = status;
+    published.frame = sequence;
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+    m_dirtyBegin = status.dirtyBegin;
+    m_dirtyEnd = status.dirtyEnd;
+    writeFrameStatus(*header(), published);
+  }
+  return sequence;
+}
+
+void FramePublisher::updateStatus(RadarFrameStatus const &status) noexcept {
+  if (!valid()) return;
+  RadarFrameStatus published = status;
+  published.frame = m_sequence;
+  std::lock_guard<std::mutex> lock(m_statusMutex);
+  writeFrameStatus(*header(), published);
+}
+
+void FramePublisher::updateProgress(RadarFrameStatus const &status) noexcept {
+  if (!valid()) return;
+  RadarFrameStatus published = status;
+  published.frame = m_sequence;
+  std::lock_guard<std::mutex> lock(m_statusMutex);
+  published.dirtyBegin = m_dirtyBegin;
+  published.dirtyEnd = m_dirtyEnd;
+  writeFrameStatus(*header(), published);
+}
+
+char const *FramePublisher::front() const noexcept {
+  if (!valid() || m_sequence == 0) return nullptr;
+  return frame(header()->latest.load(std::memory_order_relaxed));
+}
+
+char *FramePublisher::segment() noexcept {
+  return m_shm->data();
+}
+
+RadarFrameHeader *FramePublisher::header() const noexcept {
+  return reinterpret_cast<RadarFrameHeader*>(m_shm->data());
+}
+
+char *FramePublisher::frame(uint32_t index) const noexcept {
+  return m_shm->data() + FRAME_DATA_OFFSET + size_t(index) * m_frameBytes;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef FRAME_PUBLISHER
+#define FRAME_PUBLISHER
+
+#include "cluon-complete.hpp"
+#include "radar-frame.hpp"
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+//Writer side of the published frames segment (see radar-frame.hpp). Every publish copies a finished image into the
+//buffer after the latest one and then makes it the latest, so a reader always finds a whole frame. With three
+//buffers a reader has two publishes' time to finish its copy.
+//Publishes must not overlap each other, but the status may be updated from another thread while a frame is published.
+class FramePublisher {
+ private:
+  FramePublisher(const FramePublisher &) = delete;
+  FramePublisher(FramePublisher &&)      = delete;
+  FramePublisher &operator=(const FramePublisher &) = delete;
+  FramePublisher &operator=(FramePublisher &&) = delete;
+
+ public:
+  //buffers is clamped to 2 to RADAR_FRAME_MAX_BUFFERS.
+  FramePublisher(std::string const &name, uint16_t c_width, uint16_t c_height, uint32_t buffers = 3) noexcept;
+
+  bool valid() const noexcept;
+  uint32_t buffers() const noexcept;
+  uint32_t frameBytes() const noexcept;
+
+  //Copies a width * height * 4 byte image into the next buffer and publishes it with the given time in
+  //microseconds. Returns the frame number.
+  uint64_t publish(char const *image, int64_t timestamp) noexcept;
+
+  //Same, and publishes the status with it. The frame number in status is set by the publisher.
+  uint64_t publish(char const *image, int64_t timestamp, RadarFrameStatus const &status) noexcept;
+
+  //Publishes the status alone, such as the latest azimuth between frames. Cheap enough for every spoke.
+  void updateStatus(RadarFrameStatus const &status) noexcept;
+
+  //Same, but keeps the dirty range of the latest frame published with a status, as it describes that frame and not
+  //the spokes decoded since.
+  void updateProgress(RadarFrameStatus const &status) noexcept;
+
+  //Latest published frame, or nullptr before the first publish. Only for the writer process.
+  char const *front() const noexcept;
+
+  //The whole segment, header first.
+  char *segment() noexcept;
+
+ private:
+  RadarFrameHeader *header() const noexcept;
+  char *frame(uint32_t index) const noexcept;
+
+  uint32_t m_buffers;
+  uint32_t m_frameBytes;
+  std::atomic<uint64_t> m_sequence{0};
+  //Writers of the status seqlock, and the dirty range of the latest frame.
+  std::mutex m_statusMutex{};
+  uint16_t m_dirtyBegin{0};
+  uint16_t m_dirtyEnd{0};
+  std::unique_ptr<cluon::SharedMemory> m_shm;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <utility>
+
+#include "navigation-state.hpp"
+
+NavigationState::NavigationState() noexcept {
+}
+
+void NavigationState::onHeading(cluon::data::Envelope &&env) noexcept {
+  if (env.dataType() != opendlv::proxy::GeodeticHeadingReading::ID()) return;
+  int64_t const timestamp = cluon::time::toMicroseconds(env.sampleTimeStamp());
+  opendlv::proxy::GeodeticHeadingReading const msg = cluon::extractMessage<opendlv::proxy::GeodeticHeadingReading>(std::move(env));
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_heading = msg.northHeading();
+  m_headingTime = timestamp;
+  m_headings++;
+}
+
+void NavigationState::onSpeed(cluon::data::Envelope &&env) noexcept {
+  if (env.dataType() != opendlv::proxy::GroundSpeedReading::ID()) return;
+  int64_t const timestamp = cluon::time::toMicroseconds(env.sampleTimeStamp());
+  opendlv::proxy::GroundSpeedReading const msg = cluon::extractMessage<opendlv::proxy::GroundSpeedReading>(std::move(env));
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_speed = msg.groundSpeed();
+  m_speedTime = timestamp;
+  m_speeds++;
+}
+
+bool NavigationState::heading(float &northHeading, int64_t &timestamp) const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  northHeading = m_heading;
+  timestamp = m_headingTime;
+  return m_headings > 0;
+}
+
+bool NavigationState::speed(float &groundSpeed, int64_t &timestamp) const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  groundSpeed = m_speed;
+  timestamp = m_speedTime;
+  return m_speeds > 0;
+}
+
+uint64_t NavigationState::headings() const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_headings;
+}
+
+uint64_t NavigationState::speeds() const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_speeds;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NAVIGATION_STATE
+#define NAVIGATION_STATE
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include <cstdint>
+#include <mutex>
+
+//Own ship heading and speed from the navigation messages on the session, kept apart from the radar spokes. The
+//handlers are registered per message type, so they only see their own envelopes, and only store the latest value.
+//Written by the receive thread, read by any thread.
+class NavigationState {
+ private:
+  NavigationState(const NavigationState &) = delete;
+  NavigationState(NavigationState &&)      = delete;
+  NavigationState &operator=(const NavigationState &) = delete;
+  NavigationState &operator=(NavigationState &&) = delete;
+
+ public:
+  NavigationState() noexcept;
+
+  //Handlers for GeodeticHeadingReading and GroundSpeedReading envelopes. Envelopes of other types are ignored.
+  void onHeading(cluon::data::Envelope &&env) noexcept;
+  void onSpeed(cluon::data::Envelope &&env) noexcept;
+
+  //Latest heading from north in radians and ground speed in m/s, with their sample time in microseconds. False
+  //until the first message.
+  bool heading(float &northHeading, int64_t &timestamp) const noexcept;
+  bool speed(float &groundSpeed, int64_t &timestamp) const noexcept;
+
+  //Messages handled so far.
+  uint64_t headings() const noexcept;
+  uint64_t speeds() const noexcept;
+
+ private:
+  mutable std::mutex m_mutex{};
+  float m_heading{0};
+  int64_t m_headingTime{0};
+  uint64_t m_headings{0};
+  float m_speed{0};
+  int64_t m_speedTime{0};
+  uint64_t m_speeds{0};
+};
+
+#endif
@@ -16,18 +16,40 @@
  */
 
 #include <iostream>
+#include <atomic>
 #include <thread>
 #include <chrono>
 #include <math.h>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <mutex>
 
 #include <iostream>
 #include <fstream>
 
 #include "cluon-complete.hpp"
 #include "opendlv-standard-message-set.hpp"
+#include "aggregate-renderer.hpp"
+#include "dirty-region.hpp"
+#include "frame-mailbox.hpp"
+#include "frame-publisher.hpp"
+#include "navigation-state.hpp"
+#include "radar-channel.hpp"
 #include "radar-decoder.hpp"
-#include <X11/Xlib.h>
+#include "renderer.hpp"
+#include "sample-format.hpp"
+#include "scan-table-cache.hpp"
+#include "sector-decoder.hpp"
+#include "shared-scan-table.hpp"
+#include "spoke-kernel.hpp"
+#include "spoke-queue.hpp"
+#include "spoke-throttle.hpp"
+#include "sweep-assembler.hpp"
+#ifdef HAVE_X11
+#include "x11-display.hpp"
+#endif
 
 
 
@@ -64,6 +86,22 @@ int32_t main(int32_t argc, char **argv) {
 
     std::cerr << argv[0] << " Provides ppi and navigation for Navico Radar Units."<< std::endl;
     std::cerr << "Requires a cluon id to capture from. Typical usage with other openDLV services is <-cid=111> "<< std::endl;
+    std::cerr << "Optional: --sector=<spokes> with --decoders, spokes the decode workers write before letting the render thread at the image."<< std::endl;
+    std::cerr << "Optional: --renderer=forward|inverse and --threads=<n> to select how the image is rendered."<< std::endl;
+    std::cerr << "Optional: --aggregate=last|max|mean to combine samples landing on the same pixel near the origin."<< std::endl;
+    std::cerr << "Optional: --range=<m> range shown from the centre to the edge of the image, taken from the first spoke by default, and --range-tables=<n> range scales whose tables are kept."<< std::endl;
+    std::cerr << "Optional: --radars=<stamp>[,<stamp>...] to serve several radars, selected by the senderStamp of their envelopes, each with its own <name>-<stamp> image. --id=<stamp> sets the senderStamp of the demo spokes."<< std::endl;
+    std::cerr << "Optional: --decoders=<n> sector-parallel decode workers for the forward renderer."<< std::endl;
+    std::cerr << "Optional: --fps=<hz> rate the image is rendered and shown at, 0 for once per sweep."<< std::endl;
+    std::cerr << "Optional: --palette=classic|grey|green|day|night, --gain=<x> and --gamma=<x> to colour the image. Keys p, +, -, g, G and 0 change them in the window."<< std::endl;
+    std::cerr << "Optional: --buffers=<n> frame buffers in the published <name>.frames segment."<< std::endl;
+    std::cerr << "Optional: --spokes=<n> spokes per revolution, --bins=<n> values per spoke and --canvas=<px> width and height of the image (default 2048, 512 and twice the bins)."<< std::endl;
+    std::cerr << "Optional: --samples=8bit|4bit|4bit-high encoding of the spoke samples, one per byte or two per byte with the low or high nibble first."<< std::endl;
+    std::cerr << "Optional: --queue=<slots> spokes buffered between the receive and decode threads."<< std::endl;
+    std::cerr << "Optional: --overload=off|drop-oldest|latest|decimate|auto spokes skipped when decoding falls behind."<< std::endl;
+    std::cerr << "Optional: --private-table to build the scan table for this process only instead of sharing it."<< std::endl;
+    std::cerr << "Optional: --display=none|x11 to run without a window or to show the image in an X11 window."<< std::endl;
+    std::cerr << "Optional: --no-xshm to send the image through the X connection instead of the MIT-SHM extension."<< std::endl;
     
   } else {
 
@@ -74,10 +112,95 @@ int32_t main(int32_t argc, char **argv) {
     bool const verbose{commandlineArguments.count("verbose") != 0};
     bool const timings{commandlineArguments.count("timings") != 0};
     bool const demo{commandlineArguments.count("demo") != 0};
+    bool const privateTable{commandlineArguments.count("private-table") != 0};
+    bool const noXshm{commandlineArguments.count("no-xshm") != 0};
+#ifdef HAVE_X11
+    std::string const displayMode{(commandlineArguments["display"].size() != 0) 
+      ? commandlineArguments["display"] : "x11"};
+#else
+    std::string const displayMode{(commandlineArguments["display"].size() != 0) 
+      ? commandlineArguments["display"] : "none"};
+#endif
+
+    //Number of spokes written before the image is rendered and the consumers of the shared memory are notified.
+    //0 leaves it to the render thread. 
+    uint16_t const sector{static_cast<uint16_t>((commandlineArguments["sector"].size() != 0) 
+      ? std::stoi(commandlineArguments["sector"]) : 0)};
   
     std::string const name{(commandlineArguments["name"].size() != 0) 
       ? commandlineArguments["name"] : "/polar0"};
 
+    //forward scatters the changed spokes into the image, inverse gathers every pixel from its spoke and bin. 
+    bool const inverse{commandlineArguments["renderer"] == "inverse"};
+    uint32_t const threads{(commandlineArguments["threads"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["threads"])) : 1};
+    //Spokes buffered between the receive and decode threads; about half a revolution by default. 
+    uint32_t const queueSlots{(commandlineArguments["queue"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["queue"])) : 1024};
+    //Sector-parallel decode workers for the forward renderer. 1 decodes on the decode thread itself. 
+    uint32_t const decoders{(commandlineArguments["decoders"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["decoders"])) : 1};
+    //Display and frame rate of the render thread. 0 renders once per completed sweep. 
+    uint32_t const fps{(commandlineArguments["fps"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["fps"])) : 25};
+    //Colouring of the image, and the strength adjustment applied before it. 
+    PalettePreset palettePreset{PalettePreset::Classic};
+    if (commandlineArguments["palette"].size() != 0 && !parsePreset(commandlineArguments["palette"], palettePreset)) {
+      std::cerr << "Unknown palette " << commandlineArguments["palette"] << ", using " << presetName(palettePreset) << std::endl;
+    }
+    float const gain{(commandlineArguments["gain"].size() != 0) 
+      ? std::stof(commandlineArguments["gain"]) : 1.0f};
+    float const gamma{(commandlineArguments["gamma"].size() != 0) 
+      ? std::stof(commandlineArguments["gamma"]) : 1.0f};
+    //Encoding of the samples in the spokes. 
+    SampleFormat sampleFormat{SampleFormat::Byte};
+    if (commandlineArguments["samples"].size() != 0 && !parseSampleFormat(commandlineArguments["samples"], sampleFormat)) {
+      std::cerr << "Unknown sample format " << commandlineArguments["samples"] << ", using " << sampleFormatName(sampleFormat) << std::endl;
+    }
+    //What the decode threads skip when the queues fill. 
+    Overload overload{Overload::Auto};
+    if (commandlineArguments["overload"].size() != 0 && !parseOverload(commandlineArguments["overload"], overload)) {
+      std::cerr << "Unknown overload policy " << commandlineArguments["overload"] << ", using " << overloadName(overload) << std::endl;
+    }
+    //How samples landing on the same pixel are combined by the forward renderer. 
+    Aggregation aggregation{Aggregation::Max};
+    if (commandlineArguments["aggregate"].size() != 0 && !parseAggregation(commandlineArguments["aggregate"], aggregation)) {
+      std::cerr << "Unknown aggregation " << commandlineArguments["aggregate"] << ", using " << aggregationName(aggregation) << std::endl;
+    }
+    //Range shown from the centre to the edge of the image in meters. Spokes of other ranges are drawn to this scale;
+    //0 takes the scale from the first range the radar reports. 
+    float const displayRange{(commandlineArguments["range"].size() != 0) 
+      ? std::stof(commandlineArguments["range"]) : 0.0f};
+    //Range scales whose tables are kept, so switching back to one does not rebuild them. 
+    uint32_t const rangeTables{(commandlineArguments["range-tables"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["range-tables"])) : 4};
+    //Radars served by this process, by the senderStamp of their envelopes. Without --radars one radar takes every
+    //envelope on the cid. 
+    std::vector<uint32_t> senderStamps{0};
+    bool const byStamp{commandlineArguments["radars"].size() != 0};
+    if (byStamp && !parseSenderStamps(commandlineArguments["radars"], senderStamps)) {
+      std::cerr << "Invalid --radars " << commandlineArguments["radars"] << ", expected sender stamps such as 1,2" << std::endl;
+      return 1;
+    }
+    //Geometry of the radar and the image. The image is square with the radar at its centre, and must hold a whole
+    //spoke at one pixel per value. 
+    uint32_t const spokes{(commandlineArguments["spokes"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["spokes"])) : 2048};
+    uint32_t const bins{(commandlineArguments["bins"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["bins"])) : 512};
+    uint32_t const canvas{(commandlineArguments["canvas"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["canvas"])) : bins * 2};
+    if (spokes == 0 || spokes > 4096 || bins == 0 || bins > 4096 || canvas > 16384 || bins > canvas / 2) {
+      std::cerr << "Invalid geometry of " << spokes << " spokes, " << bins << " bins and a " << canvas << " pixel image. Up to 4096 spokes and bins, with bins at most half the image" << std::endl;
+      return 1;
+    }
+    if (overload == Overload::LatestPerAzimuth && queueSlots <= spokes) {
+      std::cerr << "--overload=latest only skips spokes more than a sweep behind, which a queue of " << queueSlots << " slots never holds with " << spokes << " spokes" << std::endl;
+    }
+    //Frame buffers in the published frames segment. 
+    uint32_t const buffers{(commandlineArguments["buffers"].size() != 0) 
+      ? static_cast<uint32_t>(std::stoi(commandlineArguments["buffers"])) : 3};
+
     //Set Model
 
     //Used to build the image if on first frame capture
@@ -93,261 +216,505 @@ int32_t main(int32_t argc, char **argv) {
     uint8_t frame_idx = 0;
 
 
-    //Fixed values for use with a Navico Radar (Spoke Length is 512 values)
-    uint16_t origin, c_width, c_height;
-    origin = 512;
-    c_width = origin*2;
-    c_height = origin*2;
+    //Radar at the centre of the image. 
+    uint16_t const origin{static_cast<uint16_t>(canvas / 2)};
+    uint16_t const c_width{static_cast<uint16_t>(canvas)};
+    uint16_t const c_height{static_cast<uint16_t>(canvas)};
     float current_angle;
 
-    //Set image name
-    std::string const nameArgb{name + ".argb"};
-
-
-    //Address for image
-    std::unique_ptr<cluon::SharedMemory> shmArgb{
-      new cluon::SharedMemory{nameArgb, c_width * c_height * 4}};
-
     //Address for prior image
     //std::unique_ptr<cluon::SharedMemory> priorArgb{
       //new cluon::SharedMemory{nameArgb, c_width * c_height * 4}};
 
-    //Address for lookup_cache
-    uint16_t addBk [2048][512*2];
-
-    //Build Timing Variables
-    cluon::data::TimeStamp pT1, pT2;
+    //Strength to pixel colouring. Switched at runtime from the window, see adjustPalette. 
+    PaletteSettings paletteSettings{palettePreset, gain, gamma};
+    ActivePalette activePalette{makePalette(paletteSettings.preset, paletteSettings.gain, paletteSettings.gamma)};
 
     //Build pixelmap
 
     //The radar spoke data comprises of an azimuth, an index (distance) and a strength. Instead of cranking out some square root functions each time
-    //spoke data is received, we can create a lookup table instead. The 2d array is 2048*(512*2). 2048 spokes per circle, with 512 values per spoke.
-    //Each value needs both an x and y, hence the *2. 
-
-    for (int i = 0; i <= 4095; i++){
-      for (int j = 0; j<= 511; j++) {
-        uint16_t distance = j;
-        float angle = (float(i)/4096*360);
-        float angle_rad;
-        uint16_t x, y;
-
-        if (angle < 90) {
-          angle_rad = radians(angle);
-          x = round(origin+((sin(angle_rad)*distance)));
-          y = round(origin-((cos(angle_rad)*distance)));
-        }
-        
-        else if (angle < 180) {
-          angle_rad = radians(angle-90);
-          x = round(origin+((cos(angle_rad)*distance)));
-          y = round(origin+((sin(angle_rad)*distance)));
-        }
-        
+    //spoke data is received, we can create a lookup table instead. The table holds --spokes spokes per circle, with --bins values per spoke.
+    //Each value is the byte offset of its pixel in the image, checked against the image size once here. 
+    //Instances with the same geometry share one table in shared memory; the first one builds it.
+    std::unique_ptr<SharedScanTable> sharedTable;
+    std::unique_ptr<ScanTable> ownTable;
+    if (privateTable) {
+      ownTable.reset(new ScanTable{origin, c_width, c_height, uint16_t(spokes), uint16_t(bins)});
+    } else {
+      sharedTable.reset(new SharedScanTable{origin, c_width, c_height, uint16_t(spokes), uint16_t(bins)});
+    }
+    ScanTable const &table = privateTable ? *ownTable : sharedTable->table();
+    if (verbose && sharedTable) std::cout << "Scan table " << sharedTable->name() << (sharedTable->attached() ? " attached" : (sharedTable->shared() ? " built and shared" : " built privately")) << std::endl;
+
+    if (verbose) std::cout << "Scatter kernel: " << kernelName(detectKernelLevel()) << ", samples: " << sampleFormatName(sampleFormat) << std::endl;
+
+    //Threads the inverse renderer renders rows with. With several radars the forward renderer draws their images on
+    //them in parallel. 
+    ThreadPool pool{threads};
+    if (verbose) std::cout << "Renderer: " << (inverse ? "inverse" : "forward") << " with " << pool.threads() << " threads" << std::endl;
+
+    //Tables at one pixel per bin, used until a radar reports a range: the screen area of every spoke, so the display
+    //only receives the parts of the image that changed, and the pixel to spoke and bin map of the inverse renderer.
+    //Near the origin many samples land on one pixel. The forward renderer on the decode and render threads combines
+    //them with --aggregate; the sector decoders and the inverse renderer keep one sample per pixel. 
+    bool const sectorDecoders{decoders > 1 && !inverse};
+    Aggregation const forwardAggregation{sectorDecoders ? Aggregation::Last : aggregation};
+    std::shared_ptr<RangeTables const> const nativeTables{std::make_shared<RangeTables>(table, 0, inverse, forwardAggregation)};
+    FanInTable const *fanIn = nativeTables->fanIn();
+    if (verbose && fanIn) std::cout << "Aggregation: " << aggregationName(aggregation) << " over " << fanIn->sharedPixels() << " shared pixels, fan-in up to " << fanIn->maxFanIn() << std::endl;
+
+    //Spokes carry the range their bins cover. The images keep one scale in meters per pixel, drawn with tables built
+    //for each range a radar switches to and shared by the radars at that range. The sector decoders are bound to
+    //the table at one pixel per bin. 
+    std::unique_ptr<ScanTableCache> rangeCache;
+    if (!sectorDecoders) rangeCache.reset(new ScanTableCache{origin, c_width, c_height, table.spokes(), table.bins(), displayRange / origin, rangeTables, inverse, forwardAggregation});
+
+    //One channel per radar with its image, published frames, polar buffer and queue. A single radar keeps the given
+    //name; with --radars each is named <name>-<senderStamp>. 
+    std::vector<std::unique_ptr<RadarChannel>> radars;
+    //Latest own ship heading and speed, shared by the radars. 
+    NavigationState navigation;
+    for (uint32_t stamp : senderStamps) {
+      std::string const radarName{byStamp ? name + "-" + std::to_string(stamp) : name};
+      radars.emplace_back(new RadarChannel{stamp, radarName, c_width, c_height, buffers, queueSlots, sector, nativeTables, overload, sampleFormat});
+      RadarChannel &radar = *radars.back();
+      //The renderers and sector decoders write straight into the image, so a radar without one cannot run. 
+      if (!radar.image->valid() || radar.image->size() < table.canvasSize()) {
+        std::cerr << "Invalid Memory Allocation for " << radar.name << ": " << radar.image->size() << " bytes for a canvas of " << table.canvasSize() << std::endl;
+        return 1;
+      }
+      if (verbose) std::cout << "Radar " << radar.name << (byStamp ? " for sender " + std::to_string(stamp) : "") << ", canvas size: " << table.canvasSize() << ". Should match size of alloc mem: " << radar.image->size() << std::endl;
 
-        else if (angle < 270) {
-          angle_rad = radians(angle-180);
-          x = round(origin-((sin(angle_rad)*distance)));
-          y = round(origin+((cos(angle_rad)*distance)));
-        }
-        
-        else if (angle < 360){
-          angle_rad = radians(angle-270);
-          x = round(origin-((cos(angle_rad)*distance)));
-          y = round(origin-((sin(angle_rad)*distance)));
-        }
-        
-        addBk[i/2][j*2] = x;
-        addBk[i/2][(j*2)+1] = y;
+      //With --decoders above 1 the spokes are decoded by workers that each own a sector of azimuths and write their
+      //part of the image in parallel. 
+      if (sectorDecoders && radar.image->valid()) radar.sectorDecoder.reset(new SectorDecoder{table, activePalette.current(), radar.polar, radar.image->data(), decoders});
+      if (verbose && radar.sectorDecoder) std::cout << "Sector decoders: " << radar.sectorDecoder->workers() << ", pixels shared at seams: " << radar.sectorDecoder->partition().sharedPixels() << std::endl;
+    }
+    RadarChannel &shown = *radars.front();
+
+    //Pushes the image, or with rects only those parts of it, to the display. Empty when running headless with
+    //--display=none, where the service only fills the shared memory. 
+    std::function<void(std::vector<Rect> const *rects)> showImage;
+    //Takes the next key typed into the display without waiting. 
+    std::function<bool(char &key)> nextKey;
+#ifdef HAVE_X11
+    //Window showing the image of the first radar. MIT-SHM lets the X server read the image segment directly; without
+    //it, or with --no-xshm, the image is sent through the X connection. 
+    std::unique_ptr<X11Display> x11;
+    if (displayMode == "x11" && shown.image->valid()) {
+      x11.reset(new X11Display{*shown.image, c_width, c_height, !noXshm});
+      if (x11->valid()) {
+        showImage = [&x11](std::vector<Rect> const *rects) {
+          if (rects == nullptr) {
+            x11->show();
+          } else {
+            x11->show(*rects);
+          }
+        };
+        nextKey = [&x11](char &key) {
+          return x11->nextKey(key);
+        };
+        if (verbose) std::cerr << "Memory Allocated and X11 Image Initialised, backend: " << backendName(x11->backend()) << std::endl;
+      } else {
+        std::cerr << "Could not open the X display, running without a window." << std::endl;
       }
     }
+#else
+    if (displayMode == "x11") std::cerr << "Built without X11, running without a window." << std::endl;
+#endif
 
-    if (verbose) std::cout << "Address Book Init with size: " << sizeof(addBk) << ". Should match size of alloc mem: " << shmArgb->size() << std::endl; //This could be a test. 
-    //Set X11 Paramaters
-    Display* display{nullptr};
-    Visual* visual{nullptr};
-    Window window{0};
-    XImage* ximage{nullptr};
-    if (verbose) std::cout << "X11 Params set" << std::endl;
-
-    //If the shared memory is valid, build the image out of the shared memory values
-    if (shmArgb->valid()) {
-      display = XOpenDisplay(NULL);
+    if (verbose) std::cout << "Model and paramaters built. Begining listener" << std::endl;
 
+    //Spokes are handed from the receive thread to the decode threads through a queue of preallocated slots per
+    //radar, so a slow render or display flush does not hold up the UDP receive path. 
+    std::atomic<bool> decoding{true};
 
-      visual = DefaultVisual(display, 0);
+    //Lets the render thread in between sectors of the sector decoders. 
+    auto releaseImage = [&decoding](RadarChannel &radar) {
+      radar.sectorDecoder->drain();
+      radar.imageHeld = false;
+      radar.image->unlock();
+      while (radar.renderWanted && decoding) std::this_thread::yield();
+    };
 
-      window = XCreateSimpleWindow(display, RootWindow(display, 0), 0, 0, c_width, c_height, 1, 0, 0);
-    
-      shmArgb->lock();
-      {
-        
-        ximage = XCreateImage(display, visual, 24, ZPixmap, 0, shmArgb->data(), c_width, c_height, 32, c_width*4);
-        
-      }
-      shmArgb->unlock();
-      if (verbose) {
-        std::cerr << "Memory Allocated and X11 Image Initialised" << std::endl;
+    //Decodes one spoke of a radar into its polar buffer, or with --decoders into the image. The changes of every
+    //spoke are handed to the render thread through the mailbox of the radar, and the render thread draws, publishes
+    //and shows the newest state at its own pace. 
+    auto decodeSpoke = [timings, verbose, byStamp, &navigation, &rangeCache, &releaseImage, &current_angle, &model_update, &initial, &frame_idx](RadarChannel &radar, SpokeView const &received) {
+      cluon::data::TimeStamp cT_now = cluon::time::now();
+      //One byte per sample from here on, unpacked into the buffer of the radar for 4 bit spokes. 
+      SpokeView const msg = radar.unpacker.unpack(received);
+
+      int current_azimuth;
+      if (radar.sectorDecoder) {
+        //The workers write the image directly, so it is held from the first spoke after a commit to the next
+        //commit and consumers only see whole sectors. 
+        if (radar.imageHeld && radar.renderWanted) releaseImage(radar);
+        if (!radar.imageHeld) {
+          radar.image->lock();
+          radar.imageHeld = true;
+        }
+        int pushed;
+        while ((pushed = radar.sectorDecoder->push(msg)) == -14) std::this_thread::yield();
+        current_azimuth = (pushed < 0) ? pushed : int(msg.azimuth);
+      } else {
+        //A new range starts from an empty sweep, drawn with the tables of that range. They are looked up, or built,
+        //before the render thread is locked out of the polar buffer; the tables are only changed by this thread. 
+        std::shared_ptr<RangeTables const> nextTables;
+        if (rangeCache && msg.range > 0 && uint32_t(std::lround(msg.range)) != radar.tables->range()) {
+          nextTables = rangeCache->tables(msg.range);
+        }
+        std::lock_guard<std::mutex> lock(radar.polarMutex);
+        if (nextTables) {
+          radar.switchRange(std::move(nextTables));
+          if (verbose) std::cout << (byStamp ? radar.name + ": " : "") << "Range " << radar.tables->range() << " m at " << radar.tables->table().pixelsPerBin() << " pixels per bin, " << rangeCache->size() << " ranges kept, " << rangeCache->builds() << " built" << std::endl;
+        }
+        current_azimuth = decode(msg, radar.polar, verbose);
       }
+      if (current_azimuth < 0) return;
 
-    } else {
-      if (verbose) {
-        std::cerr << "Invalid Memory Allocation" << std::endl;
-      }
-    }
+      uint32_t const spoke = uint32_t(spokeIndex(msg, radar.polar.spokes(), false));
+      bool const sectorComplete = commitSector(radar.commit, spoke);
 
-    
+      //A sweep is complete when the spokes pass north, not counting stray or out of order azimuths. 
+      bool const sweepComplete = radar.sweeps.add(spoke, cluon::time::toMicroseconds(cT_now));
+      RadarFrameStatus &status = radar.status;
+      if (sweepComplete) {
+        status.sweep = radar.sweeps.sweeps();
+        status.sweepTimestamp = radar.sweeps.last().end;
+      }
+      status.lastAzimuth = msg.azimuth;
+      //The dirty range is set by the render thread for each frame it publishes, from the spokes in the mailbox. 
+      radar.frames.updateProgress(status);
+      radar.mailbox.post(status, spoke, sweepComplete);
+
+      //With --decoders the workers hold the image for a sector of spokes at a time, so the render thread, which
+      //publishes every frame, only sees whole sectors. 
+      if (sectorComplete && radar.sectorDecoder) {
+        radar.sectorDecoder->drain();
+        radar.imageHeld = false;
+        radar.image->unlock();
+      }
 
-    if (verbose) std::cout << "Model and paramaters built. Begining listener" << std::endl;
 
-    //Start Lambda function that fires on recieving a RadarDetectionReading envelope on the cluon id. 
-    cluon::OD4Session od4{static_cast<uint16_t>(
-        std::stoi(commandlineArguments["cid"])), [&pT1, &pT2, timings, &addBk, &shmArgb, c_width, c_height, &display, &visual, &window, &ximage, &current_angle, origin, &model_update, &initial, &frame_idx, verbose](cluon::data::Envelope &&env){
-            cluon::data::TimeStamp cT_now = cluon::time::now();
-            uint16_t test_c = 0;
+      /*
+      //For optic flow
+      //Check initial rotation is complete
+      if (msg.azimuth() == 2 && init) {
+        std::vector<uint16_t[4]> pixel_list;
+        //Retrieve current index list. 
 
+        //Define pixel block. 
+          //Xi neighbour Xii is +-4
+          //Yi neighbour Yii is +-(512*4)
+          //Pixel 0 is 0,0 [0:3], index 0. Pixel 1 is 1,0 is [4:7], index 4. 
+          //Pixel 512 is 1,0 [2048:2051], index 2048. Pixel 513 is 1,1 [2052:2055], index 2052.
+          //Resolve for y first. Add x. 
 
-            //Now, we unpack the cluon::data::Envelope to get our message.
-            opendlv::proxy::RadarDetectionReading msg = cluon::extractMessage<opendlv::proxy::RadarDetectionReading>(std::move(env));
-            uint16_t current_azimuth = decode(msg, shmArgb, addBk, verbose, origin, c_height, c_width);
-            
+          //To compare 1,1 to surroundings.
 
-            //If the azimuth has completed a circle
-            //Use 2 instead of 0 as dropped packets hold a 0 val for azimuth and will trigger this. 
-            if (remainder(current_azimuth, 170) == float(0)) {
-              
-              //Build PPI
-              if (verbose) std::cout << "Updating window: " << msg.azimuth() << std::endl;
-              
-              XMapWindow(display, window);
+        //for  
+        //for for
+        uint32_t current_index = ((4*current_x)+(1024*current_y)*4);
+        uint16_t closest_array[4];
+        uint16_t low_val = shmArgb->data()[current_index]-priorArgb->data()[current_index];
 
-              shmArgb->lock();
 
-              XPutImage(display, window, DefaultGC(display, 0), ximage, 0, 0, 0, 0,
-              c_width, c_height);
-      
-              shmArgb->unlock();
-              shmArgb->notifyAll();
+        for (uint8_t y_r = comp_low; y_r <= comp_high; x++) {
+          uint16_t y_index = current_y + y_r; 
+          if (y_index > 1024 || y_index < 0){
+            continue;
+          }
 
+          for (uint8_t x_r = comp_low; x_r <= comp_high; y++){
+            if (y_index > 1024 || y_index < 0){
+              continue;
             }
+            uint16_t x_index = current_x + x_r;
+            uint32_t lookup_index = ((4*x_index)+(1024*y_index)*4);
+            uint16_t pixel_dif = shmArgb->data()[current_index]-priorArgb->data()[lookup_index];
+            if (pixel_dif < low_val) {
+
+              low_val = pixel_dif;
+              closest_array[0] = current_x;
+              closest_array[1] = current_y;
+              closest_array[2] = x_r;
+              closest_array[3] = y_r;
+            }
+          }
+        }
 
+        pixel_list.push_back(closest_array);
 
-            /*
-            //For optic flow
-            //Check initial rotation is complete
-            if (msg.azimuth() == 2 && init) {
-              std::vector<uint16_t[4]> pixel_list;
-              //Retrieve current index list. 
 
-              //Define pixel block. 
-                //Xi neighbour Xii is +-4
-                //Yi neighbour Yii is +-(512*4)
-                //Pixel 0 is 0,0 [0:3], index 0. Pixel 1 is 1,0 is [4:7], index 4. 
-                //Pixel 512 is 1,0 [2048:2051], index 2048. Pixel 513 is 1,1 [2052:2055], index 2052.
-                //Resolve for y first. Add x. 
 
-                //To compare 1,1 to surroundings.
+        //close close
+        //
+        
+        
+      
+        
+        
 
-              //for  
-              //for for
-              uint32_t current_index = ((4*current_x)+(1024*current_y)*4);
-              uint16_t closest_array[4];
-              uint16_t low_val = shmArgb->data()[current_index]-priorArgb->data()[current_index];
+        shmArgb->lock();
+        priorArgb->lock();
+          
+        //Copy contents of current image to old image. 
+        memcpy(&priorArgb, &shmArgb, sizeof(priorArgb));
+          
+          
+        shmArgb->unlock();
+        priorArgb->unlock();
 
+        
+        
+      } else {
+        //Ensure that an entire circle is complete. 
+        
+          shmArgb->lock();
+          priorArgb->lock();
+          
+          //Copy contents of current image to old image. 
+          memcpy(&priorArgb, &shmArgb, sizeof(priorArgb));
+          
+          
+          shmArgb->unlock();
+          priorArgb->unlock();
+          init = true;
 
-              for (uint8_t y_r = comp_low; y_r <= comp_high; x++) {
-                uint16_t y_index = current_y + y_r; 
-                if (y_index > 1024 || y_index < 0){
-                  continue;
-                }
+      }
 
-                for (uint8_t x_r = comp_low; x_r <= comp_high; y++){
-                  if (y_index > 1024 || y_index < 0){
-                    continue;
-                  }
-                  uint16_t x_index = current_x + x_r;
-                  uint32_t lookup_index = ((4*x_index)+(1024*y_index)*4);
-                  uint16_t pixel_dif = shmArgb->data()[current_index]-priorArgb->data()[lookup_index];
-                  if (pixel_dif < low_val) {
-
-                    low_val = pixel_dif;
-                    closest_array[0] = current_x;
-                    closest_array[1] = current_y;
-                    closest_array[2] = x_r;
-                    closest_array[3] = y_r;
-                  }
-                }
-              }
+      */
+      //For Timing Diagnostics
+      if (sweepComplete && verbose) {
+        SweepInfo const &sweep = radar.sweeps.last();
+        std::cout << (byStamp ? radar.name + ": " : "") << "Sweep " << sweep.sweep << (sweep.partial ? " (partial)" : "") << ": " << sweep.duration / 1000 << " ms, " << sweep.rpm << " rpm, " << sweep.received << " spokes, " << sweep.missing << " missing in " << sweep.gapCount << " gaps, " << sweep.duplicates << " repeated, " << sweep.late << " late, " << sweep.rejected << " rejected";
+        float heading{0};
+        float speed{0};
+        int64_t sampled{0};
+        if (navigation.heading(heading, sampled)) std::cout << ", heading " << heading * 180.0f / static_cast<float>(M_PI) << " deg";
+        if (navigation.speed(speed, sampled)) std::cout << ", speed " << speed << " m/s";
+        std::cout << std::endl;
+      }
+      if (sweepComplete && timings) {
+        //std::cout << "Timings" << std::endl;
+        cluon::data::TimeStamp cT1, cT2;
+        
 
-              pixel_list.push_back(closest_array);
+        cT1 = cT_now;//current message time msg.
+        cT2 = cluon::time::now();//current Systime
 
+        float T1 = cluon::time::deltaInMicroseconds(cT1, radar.lastSpoke);
+        float T2 = cluon::time::deltaInMicroseconds(cT2, radar.lastSweep);
+        std::cout << float((T2-T1)/1000) << std::endl;
 
+        radar.lastSpoke = cT1;
+        radar.lastSweep = cT2;
 
-              //close close
-              //
-              
-              
-            
-              
-              
+        SpokeQueueStats const stats = radar.queue.stats();
+        std::cout << "Queue depth: " << stats.depth << " high-water: " << stats.highWater << " drops: " << stats.drops << std::endl;
+        OverloadStats const &overloaded = radar.throttle.stats();
+        std::cout << "Overload: " << overloadName(overloaded.active) << " decoded: " << overloaded.decoded << " dropped oldest: " << overloaded.droppedOldest << " coalesced: " << overloaded.coalesced << " decimated: " << overloaded.decimated << " mode changes: " << overloaded.modeChanges << std::endl;
+      }
+    //subfuntion draw
+    //subfunction optic
+    //subfunction timings
+    };
 
-              shmArgb->lock();
-              priorArgb->lock();
-                
-              //Copy contents of current image to old image. 
-              memcpy(&priorArgb, &shmArgb, sizeof(priorArgb));
-                
-                
-              shmArgb->unlock();
-              priorArgb->unlock();
+    //Decode threads, one per radar up to the number of cores. Each drains the queues of its radars in turn, a bounded
+    //batch at a time so a busy radar does not hold up the others, and a radar is only ever decoded by one thread. 
+    uint32_t const decodeThreads{std::min<uint32_t>(uint32_t(radars.size()), std::max(1u, std::thread::hardware_concurrency()))};
+    std::vector<std::thread> decodeWorkers;
+    for (uint32_t worker = 0; worker < decodeThreads; worker++) {
+      decodeWorkers.emplace_back([worker, decodeThreads, &radars, &decoding, &decodeSpoke, &releaseImage](){
+          while (decoding) {
+            bool idle = true;
+            for (size_t i = worker; i < radars.size(); i += decodeThreads) {
+              RadarChannel &radar = *radars[i];
+              SpokeView msg;
+              uint32_t batch = 0;
+              while (batch < 64 && radar.throttle.next(radar.queue, msg)) {
+                decodeSpoke(radar, msg);
+                radar.queue.pop();
+                batch++;
+              }
+              if (batch == 0 && radar.imageHeld && radar.renderWanted) releaseImage(radar);
+              idle = idle && batch == 0;
+            }
+            if (idle) std::this_thread::sleep_for(200us);
+          }
+          for (size_t i = worker; i < radars.size(); i += decodeThreads) {
+            if (radars[i]->imageHeld) radars[i]->image->unlock();
+          }
+        });
+    }
 
-              
-              
+    //Render thread. Wakes --fps times a second, or with --fps=0 when the first radar completes a sweep, and renders,
+    //publishes and shows the newest state of every radar. It only waits for the image locks, never for the receive
+    //path. 
+    std::thread renderer([timings, fps, inverse, &table, &radars, &shown, &pool, &activePalette, &paletteSettings, &nextKey, &showImage, &decoding, verbose](){
+          std::chrono::microseconds const period{(fps > 0) ? 1000000 / fps : 0};
+          FramePacing pacing{period};
+          uint32_t paletteVersion = activePalette.version();
+          //Parts of the shown image changed since the last display push, from the spoke areas of its range. 
+          SpokeBounds spokeBounds{shown.tables->bounds()};
+          uint32_t boundsSwitches = 0;
+          DirtyRegion dirtyRegion{spokeBounds};
+          bool fullPush = true;
+          //Spokes of every radar drawn in the frame, and whether its image changed. 
+          std::vector<FrameTicket> tickets(radars.size());
+          std::vector<uint8_t> rendered(radars.size(), 0);
+          auto tick = std::chrono::steady_clock::now();
+          while (decoding) {
+            bool due = true;
+            if (fps > 0) {
+              tick += period;
+              std::this_thread::sleep_until(tick);
+              //After a stall the ticks start again from now instead of catching up. 
+              if (std::chrono::steady_clock::now() - tick > period) tick = std::chrono::steady_clock::now();
             } else {
-              //Ensure that an entire circle is complete. 
-              
-                shmArgb->lock();
-                priorArgb->lock();
-                
-                //Copy contents of current image to old image. 
-                memcpy(&priorArgb, &shmArgb, sizeof(priorArgb));
-                
-                
-                shmArgb->unlock();
-                priorArgb->unlock();
-                init = true;
-
+              due = shown.mailbox.waitSweep(100ms);
+              tick = std::chrono::steady_clock::now();
             }
 
-            */
-            //For Timing Diagnostics
-            if (msg.azimuth() == 2 && timings) {
-              //std::cout << "Timings" << std::endl;
-              cluon::data::TimeStamp cT1, cT2;
-              
-
-              cT1 = cT_now;//current message time msg.
-              cT2 = cluon::time::now();//current Systime
-
-              float T1 = cluon::time::deltaInMicroseconds(cT1, pT1);
-              float T2 = cluon::time::deltaInMicroseconds(cT2, pT2);
-              std::cout << float((T2-T1)/1000) << std::endl;
-
-              pT1 = cT1;
-              pT2 = cT2;
-
+            //Palette keys typed into the window, applied together as one new palette per frame. 
+            char key;
+            bool adjusted = false;
+            while (nextKey && nextKey(key)) adjusted = adjustPalette(paletteSettings, key) || adjusted;
+            if (adjusted) {
+              activePalette.set(makePalette(paletteSettings.preset, paletteSettings.gain, paletteSettings.gamma));
+              if (verbose) std::cout << "Palette " << presetName(paletteSettings.preset) << ", gain " << paletteSettings.gain << ", gamma " << paletteSettings.gamma << std::endl;
             }
-          //subfuntion draw
-          //subfunction optic
-          //subfunction timings
+            //A new palette redraws the whole image, even when no spokes arrive. The frame is drawn with the palette
+            //taken here, which is not changed while it is held. 
+            bool const repaint = (activePalette.version() != paletteVersion);
+            paletteVersion = activePalette.version();
+            std::shared_ptr<Palette const> const framePalette = activePalette.current();
+            Palette const &palette = *framePalette;
+            auto const start = std::chrono::steady_clock::now();
+
+            //Renders, publishes and, for the first radar, shows the image of one radar. 
+            auto renderRadar = [&](uint32_t index) {
+              RadarChannel &radar = *radars[index];
+              FrameTicket &ticket = tickets[index];
+              ticket = FrameTicket{};
+              bool const changed = due && radar.mailbox.take(ticket);
+              rendered[index] = ((changed || repaint) && radar.image->valid()) ? 1 : 0;
+              if (!rendered[index]) return;
+              //The frame covers the spokes changed since the previous take. 
+              ticket.status.dirtyBegin = ticket.firstSpoke;
+              ticket.status.dirtyEnd = ticket.lastSpoke;
+
+              if (radar.sectorDecoder) {
+                radar.renderWanted = true;
+                radar.image->lock();
+                radar.renderWanted = false;
+                if (repaint) {
+                  radar.sectorDecoder->setPalette(framePalette);
+                  renderAll(radar.polar, table, palette, radar.image->data());
+                }
+              } else {
+                radar.image->lock();
+                std::lock_guard<std::mutex> lock(radar.polarMutex);
+                radar.render(palette, repaint, pool);
+                //The whole image changes with the range. 
+                if (&radar == &shown && boundsSwitches != radar.rangeSwitches) {
+                  spokeBounds = radar.tables->bounds();
+                  boundsSwitches = radar.rangeSwitches;
+                  fullPush = true;
+                }
+              }
+              if (radar.frames.valid()) {
+                if (changed) {
+                  radar.frames.publish(radar.image->data(), cluon::time::toMicroseconds(cluon::time::now()), ticket.status);
+                } else {
+                  radar.frames.publish(radar.image->data(), cluon::time::toMicroseconds(cluon::time::now()));
+                }
+              }
 
+              if (&radar == &shown && showImage) {
+                //Only the rectangles holding spokes written since the last push are sent, after a first full image. 
+                fullPush = fullPush || repaint || ticket.spokes >= table.spokes();
+                if (fullPush) {
+                  showImage(nullptr);
+                  fullPush = false;
+                } else {
+                  dirtyRegion.clear();
+                  for (uint32_t spoke = ticket.firstSpoke; ; spoke = (spoke + 1) % table.spokes()) {
+                    dirtyRegion.add(spoke);
+                    if (spoke == ticket.lastSpoke) break;
+                  }
+                  showImage(&dirtyRegion.rects());
+                  if (verbose) std::cout << "Pushed " << dirtyRegion.rects().size() << " rectangles, " << dirtyRegion.area() << " pixels" << std::endl;
+                }
+              }
 
+              radar.image->unlock();
+              radar.image->notifyAll();
+            };
+
+            //The first radar is drawn on this thread, which owns the display. The forward renderer draws the others in
+            //parallel on the pool; the inverse renderer uses the pool itself. 
+            renderRadar(0);
+            if (radars.size() > 1 && !inverse) {
+              pool.parallelFor(1, uint32_t(radars.size()), [&renderRadar](uint32_t begin, uint32_t end) {
+                for (uint32_t index = begin; index < end; index++) renderRadar(index);
+              });
+            } else {
+              for (uint32_t index = 1; index < radars.size(); index++) renderRadar(index);
+            }
+            if (std::find(rendered.begin(), rendered.end(), 1) == rendered.end()) {
+              pacing.idle();
+              continue;
+            }
+            pacing.frame(tick, start, std::chrono::steady_clock::now());
+
+            if (timings && rendered[0] && tickets[0].sweepComplete) {
+              FramePacingStats const stats = pacing.stats();
+              std::cout << "Frames: " << stats.frames << " idle: " << stats.idle << " late: " << stats.late
+                << " interval: " << stats.meanInterval << " ms (jitter " << stats.jitter << ", max " << stats.maxInterval
+                << ") render: " << stats.meanRender << " ms (max " << stats.maxRender << ")" << std::endl;
+              pacing.reset();
+            }
+          }
+        });
+
+    //Join the cluon id without a catch-all delegate. Envelopes are dispatched by type to the handlers registered
+    //below, so the payloads of other traffic on the session are never parsed. 
+    cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+
+    //Start Lambda function that fires on recieving a RadarDetectionReading envelope on the cluon id. It only
+    //copies the spoke into the queue of the radar that sent it. 
+    od4.dataTrigger(opendlv::proxy::RadarDetectionReading::ID(), [&radars, byStamp, verbose](cluon::data::Envelope &&env){
+        //Without --radars every envelope goes to the one radar; with it, senders not listed are ignored. 
+        RadarChannel *radar = byStamp ? nullptr : radars.front().get();
+        for (size_t i = 0; radar == nullptr && i < radars.size(); i++) {
+          if (radars[i]->senderStamp == env.senderStamp()) radar = radars[i].get();
         }
-    
-    };
+        if (radar == nullptr) {
+          if (verbose) std::cout << "Ignoring envelope from sender " << env.senderStamp() << std::endl;
+          return;
+        }
+        //Now, we unpack the cluon::data::Envelope to get our message. The spoke is read in place from the
+        //serialized payload instead of being copied into a RadarDetectionReading and out again. 
+        std::string const payload = env.serializedData();
+        SpokeView msg;
+        if (!extractSpoke(payload, msg)) {
+          if (verbose) std::cout << "Error: Malformed RadarDetectionReading" << std::endl;
+          return;
+        }
+        radar->queue.push(msg);
+    });
+
+    //Own ship heading and speed only update the navigation state. 
+    od4.dataTrigger(opendlv::proxy::GeodeticHeadingReading::ID(), [&navigation](cluon::data::Envelope &&env){
+        navigation.onHeading(std::move(env));
+    });
+    od4.dataTrigger(opendlv::proxy::GroundSpeedReading::ID(), [&navigation](cluon::data::Envelope &&env){
+        navigation.onSpeed(std::move(env));
+    });
 
     //Set listening to true and open thread to wait for incoming messages. 
-   // od4.dataTrigger(opendlv::proxy::RadarDetectionReading::ID(), onMyMessage1); //This is in the tutorial. Seems to work without it?
-    
     bool listening = true;
     int dummy_azimuth = 0;
 
@@ -407,7 +774,7 @@ int32_t main(int32_t argc, char **argv) {
           const std::string payload(reinterpret_cast<char*>(sample.data()), sample.size());
           dummy_msg.data(payload);
           dummy_msg.range(1500);
-          od4.send(dummy_msg);
+          od4.send(dummy_msg, cluon::time::now(), id);
 
     }
 
@@ -415,6 +782,10 @@ int32_t main(int32_t argc, char **argv) {
       
       if (!demo) std::this_thread::sleep_for(1s);
     }
+    decoding = false;
+    for (std::unique_ptr<RadarChannel> const &radar : radars) radar->mailbox.close();
+    for (std::thread &worker : decodeWorkers) worker.join();
+    renderer.join();
     return retCode;
   }
 };
\ No newline at end of file
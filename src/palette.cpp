@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "palette.hpp"
+
+uint32_t paletteEntry(uint8_t b, uint8_t g, uint8_t r, uint8_t a) noexcept {
+  uint8_t const bytes[4] = {b, g, r, a};
+  uint32_t entry;
+  std::memcpy(&entry, bytes, 4);
+  return entry;
+}
+
+Palette defaultPalette() noexcept {
+  Palette palette;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint8_t const strength = uint8_t(i);
+    uint8_t inverted = strength;
+    if (strength == uint8_t(255)) {
+      inverted = uint8_t(0);
+    } else if (strength == 0) {
+      inverted = 255;
+    }
+    palette.argb[i] = paletteEntry(inverted, inverted, strength, 0);
+  }
+  return palette;
+}
+
+char const *presetName(PalettePreset preset) noexcept {
+  switch (preset) {
+    case PalettePreset::Classic: return "classic";
+    case PalettePreset::Greyscale: return "grey";
+    case PalettePreset::Green: return "green";
+    case PalettePreset::Day: return "day";
+    case PalettePreset::Night: return "night";
+  }
+  return "classic";
+}
+
+bool parsePreset(std::string const &name, PalettePreset &preset) noexcept {
+  for (uint32_t i = 0; i < PALETTE_PRESETS; i++) {
+    if (name == presetName(PalettePreset(i))) {
+      preset = PalettePreset(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+Palette makePalette(PalettePreset preset, float gain, float gamma) noexcept {
+  Palette palette;
+  for (uint32_t i = 0; i < 256; i++) {
+    float const adjusted = (i == 0) ? 0.0f : 255.0f * gain * std::pow(float(i) / 255.0f, gamma);
+    uint8_t const level = uint8_t(std::min(255.0f, std::max(0.0f, std::round(adjusted))));
+    switch (preset) {
+      case PalettePreset::Greyscale:
+        palette.argb[i] = paletteEntry(level, level, level, 0);
+        break;
+      case PalettePreset::Green:
+        palette.argb[i] = paletteEntry(uint8_t(level / 8), level, uint8_t(level / 4), 0);
+        break;
+      case PalettePreset::Day: {
+        //From a light grey background to dark blue, B, G, R.
+        uint32_t const l = level;
+        palette.argb[i] = paletteEntry(uint8_t(235 - (235 - 96) * l / 255), uint8_t(235 - (235 - 32) * l / 255),
+          uint8_t(235 - 235 * l / 255), 0);
+        break;
+      }
+      case PalettePreset::Night:
+        palette.argb[i] = paletteEntry(0, 0, uint8_t(level / 2), 0);
+        break;
+      default: {
+        uint8_t inverted = level;
+        if (level == uint8_t(255)) {
+          inverted = uint8_t(0);
+        } else if (level == 0) {
+          inverted = 255;
+        }
+        palette.argb[i] = paletteEntry(inverted, inverted, level, 0);
+      }
+    }
+  }
+  return palette;
+}
+
+bool adjustPalette(PaletteSettings &settings, char key) noexcept {
+  switch (key) {
+    case 'p':
+      settings.preset = PalettePreset((uint32_t(settings.preset) + 1) % PALETTE_PRESETS);
+      return true;
+    case '+':
+    case '=':
+      settings.gain = std::min(16.0f, settings.gain * 1.25f);
+      return true;
+    case '-':
+      settings.gain = std::max(1.0f / 16, settings.gain / 1.25f);
+      return true;
+    case 'g':
+      settings.gamma = std::min(4.0f, settings.gamma * 1.1f);
+      return true;
+    case 'G':
+      settings.gamma = std::max(0.25f, settings.gamma / 1.1f);
+      return true;
+    case '0':
+      settings.gain = 1.0f;
+      settings.gamma = 1.0f;
+      return true;
+    default:
+      return false;
+  }
+}
+
+ActivePalette::ActivePalette(Palette const &palette) noexcept
+  : m_palette(std::make_shared<Palette const>(palette)) {
+}
+
+std::shared_ptr<Palette const> ActivePalette::current() const noexcept {
+  return std::atomic_load(&m_palette);
+}
+
+void ActivePalette::set(Palette const &palette) noexcept {
+  std::atomic_store(&m_palette, std::make_shared<Palette const>(palette));
+  m_version.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t ActivePalette::version() const noexcept {
+  return m_version.load(std::memory_order_acquire);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PALETTE
+#define PALETTE
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//Strength to pixel palette. Each entry is one pixel as stored in the canvas, in byte order B, G, R, A.
+struct Palette {
+  uint32_t argb[256];
+};
+
+//The original PPI colouring. R holds the strength, B and G hold the strength with 255 and 0 swapped.
+//4th value is Alpha. Set as 0 for no transparency.
+Palette defaultPalette() noexcept;
+
+//Builds one palette entry from its channels, independent of the byte order of the host.
+uint32_t paletteEntry(uint8_t b, uint8_t g, uint8_t r, uint8_t a) noexcept;
+
+enum class PalettePreset {
+  //The original colouring, as defaultPalette().
+  Classic,
+  Greyscale,
+  //Green phosphor PPI.
+  Green,
+  //Dark echoes on a light background for daylight.
+  Day,
+  //Dim red on black, to keep the eyes adapted to the dark.
+  Night
+};
+uint32_t const PALETTE_PRESETS = 5;
+
+char const *presetName(PalettePreset preset) noexcept;
+//Accepts the names from presetName. Returns false for anything else.
+bool parsePreset(std::string const &name, PalettePreset &preset) noexcept;
+
+//Palette of a preset with the strengths adjusted first: level = 255 * gain * (strength / 255) ^ gamma, clamped to
+//255. Strength 0 stays 0, so no echo is drawn as the background.
+Palette makePalette(PalettePreset preset, float gain = 1.0f, float gamma = 1.0f) noexcept;
+
+//Preset and strength adjustment chosen by the operator.
+struct PaletteSettings {
+  PalettePreset preset{PalettePreset::Classic};
+  float gain{1.0f};
+  float gamma{1.0f};
+};
+
+//Applies a key from the display: p cycles the presets, + and - step the gain, g and G step the gamma and 0 resets
+//both. Returns false for other keys.
+bool adjustPalette(PaletteSettings &settings, char key) noexcept;
+
+//Palette in use while renderers read it from other threads. Every set() publishes a new palette that is never
+//written again, so a renderer keeps the whole palette it took from current() for as long as it holds it.
+class ActivePalette {
+ private:
+  ActivePalette(const ActivePalette &) = delete;
+  ActivePalette(ActivePalette &&)      = delete;
+  ActivePalette &operator=(const ActivePalette &) = delete;
+  ActivePalette &operator=(ActivePalette &&) = delete;
+
+ public:
+  ActivePalette(Palette const &palette) noexcept;
+
+  std::shared_ptr<Palette const> current() const noexcept;
+  void set(Palette const &palette) noexcept;
+
+  //Counts the sets, so a renderer can tell when the image needs to be drawn again.
+  uint32_t version() const noexcept;
+
+ private:
+  //Only read and written through std::atomic_load and std::atomic_store.
+  std::shared_ptr<Palette const> m_palette;
+  std::atomic<uint32_t> m_version{0};
+};
+
+#endif
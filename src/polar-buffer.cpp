@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "polar-buffer.hpp"
+
+PolarBuffer::PolarBuffer(uint16_t spokes, uint16_t bins) noexcept
+  : m_spokes(spokes)
+  , m_bins(bins)
+  , m_rows(uint32_t(spokes) * bins, 0)
+  , m_dirty(spokes, 0)
+  , m_dirtyCount(0) {
+}
+
+uint16_t PolarBuffer::spokes() const noexcept {
+  return m_spokes;
+}
+
+uint16_t PolarBuffer::bins() const noexcept {
+  return m_bins;
+}
+
+uint8_t *PolarBuffer::row(uint32_t spoke) noexcept {
+  return m_rows.data() + spoke * m_bins;
+}
+
+uint8_t const *PolarBuffer::row(uint32_t spoke) const noexcept {
+  return m_rows.data() + spoke * m_bins;
+}
+
+uint8_t const *PolarBuffer::data() const noexcept {
+  return m_rows.data();
+}
+
+void PolarBuffer::markDirty(uint32_t spoke) noexcept {
+  if (!m_dirty[spoke]) {
+    m_dirty[spoke] = 1;
+    m_dirtyCount++;
+  }
+}
+
+bool PolarBuffer::dirty(uint32_t spoke) const noexcept {
+  return m_dirty[spoke] != 0;
+}
+
+void PolarBuffer::clearDirty(uint32_t spoke) noexcept {
+  if (m_dirty[spoke]) {
+    m_dirty[spoke] = 0;
+    m_dirtyCount--;
+  }
+}
+
+uint32_t PolarBuffer::dirtyCount() const noexcept {
+  return m_dirtyCount;
+}
+
+void PolarBuffer::clearAllDirty() noexcept {
+  std::fill(m_dirty.begin(), m_dirty.end(), 0);
+  m_dirtyCount = 0;
+}
+
+void PolarBuffer::clear() noexcept {
+  std::fill(m_rows.begin(), m_rows.end(), 0);
+  std::fill(m_dirty.begin(), m_dirty.end(), 1);
+  m_dirtyCount = m_spokes;
+}
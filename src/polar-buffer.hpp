@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POLAR_BUFFER
+#define POLAR_BUFFER
+
+#include <cstdint>
+#include <vector>
+
+//Polar sweep buffer. One row of strengths per spoke, indexed by azimuth, holding the latest full revolution.
+//This is the canonical radar state; Cartesian images are rendered from it only when they are needed.
+class PolarBuffer {
+ public:
+  PolarBuffer(uint16_t spokes = 2048, uint16_t bins = 512) noexcept;
+
+  uint16_t spokes() const noexcept;
+  uint16_t bins() const noexcept;
+
+  //Strengths of one spoke, bins() bytes. spoke must be below spokes().
+  uint8_t *row(uint32_t spoke) noexcept;
+  uint8_t const *row(uint32_t spoke) const noexcept;
+
+  //All rows, spoke after spoke.
+  uint8_t const *data() const noexcept;
+
+  //Spokes written since they were last rendered.
+  void markDirty(uint32_t spoke) noexcept;
+  bool dirty(uint32_t spoke) const noexcept;
+  void clearDirty(uint32_t spoke) noexcept;
+  uint32_t dirtyCount() const noexcept;
+  void clearAllDirty() noexcept;
+
+  //Zeroes every row and marks every spoke dirty.
+  void clear() noexcept;
+
+ private:
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  std::vector<uint8_t> m_rows;
+  std::vector<uint8_t> m_dirty;
+  uint32_t m_dirtyCount;
+};
+
+#endif
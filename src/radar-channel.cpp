@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <set>
+#include <utility>
+
+#include "radar-channel.hpp"
+#include "renderer.hpp"
+
+bool parseSenderStamps(std::string const &list, std::vector<uint32_t> &stamps) noexcept {
+  std::vector<uint32_t> parsed;
+  std::set<uint32_t> seen;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) end = list.size();
+    std::string const entry = list.substr(begin, end - begin);
+    if (entry.empty() || entry.find_first_not_of("0123456789") != std::string::npos || entry.size() > 9) return false;
+    uint32_t const stamp = uint32_t(std::stoul(entry));
+    if (!seen.insert(stamp).second) return false;
+    parsed.push_back(stamp);
+    begin = end + 1;
+  }
+  stamps = parsed;
+  return true;
+}
+
+RadarChannel::RadarChannel(uint32_t stamp, std::string const &channelName, uint16_t c_width, uint16_t c_height, uint32_t buffers, uint32_t queueSlots, uint16_t sectorSpokes, std::shared_ptr<RangeTables const> rangeTables, Overload overload, SampleFormat format) noexcept
+  : senderStamp(stamp)
+  , name(channelName)
+  , image(new cluon::SharedMemory{channelName + ".argb", uint32_t(c_width) * c_height * 4})
+  , frames(channelName + ".frames", c_width, c_height, buffers)
+  , queue(queueSlots, (rangeTables->table().bins() * 4u > 2048u) ? rangeTables->table().bins() * 4u : 2048u)
+  , mailbox()
+  , renderWanted(false)
+  , sectorDecoder()
+  , polarMutex()
+  , polar(rangeTables->table().spokes(), rangeTables->table().bins())
+  , tables(std::move(rangeTables))
+  , aggregate()
+  , rangeSwitches(0)
+  , rangeDrawn(0)
+  , throttle(overload, polar.spokes())
+  , unpacker(format, polar.bins())
+  , commit()
+  , sweeps(polar.spokes())
+  , status()
+  , imageHeld(false)
+  , lastSpoke()
+  , lastSweep() {
+  commit.sectorSpokes = sectorSpokes;
+  if (tables->fanIn() != nullptr) aggregate.reset(new AggregateRenderer{tables->table(), *tables->fanIn(), tables->aggregation()});
+}
+
+void RadarChannel::render(Palette const &palette, bool all, ThreadPool &pool) noexcept {
+  if (!image->valid() || image->size() < tables->table().canvasSize()) return;
+  char *canvas = image->data();
+  if (rangeDrawn != rangeSwitches) {
+    std::memset(canvas, 0, tables->table().canvasSize());
+    rangeDrawn = rangeSwitches;
+    all = true;
+  }
+  if (tables->inverse()) {
+    renderInverse(polar, *tables->inverse(), palette, canvas, pool);
+  } else if (aggregate && all) {
+    aggregate->renderAll(polar, palette, canvas);
+  } else if (aggregate) {
+    aggregate->renderDirty(polar, palette, canvas);
+  } else if (all) {
+    renderAll(polar, tables->table(), palette, canvas);
+  } else {
+    renderDirty(polar, tables->table(), palette, canvas);
+  }
+}
+
+void RadarChannel::switchRange(std::shared_ptr<RangeTables const> next) noexcept {
+  //The renderer refers to the tables it was built for, so it goes first.
+  aggregate.reset();
+  tables = std::move(next);
+  if (tables->fanIn() != nullptr) aggregate.reset(new AggregateRenderer{tables->table(), *tables->fanIn(), tables->aggregation()});
+  rangeSwitches++;
+  polar.clear();
+}
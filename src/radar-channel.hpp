@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RADAR_CHANNEL
+#define RADAR_CHANNEL
+
+#include "cluon-complete.hpp"
+#include "aggregate-renderer.hpp"
+#include "frame-mailbox.hpp"
+#include "frame-publisher.hpp"
+#include "palette.hpp"
+#include "polar-buffer.hpp"
+#include "radar-decoder.hpp"
+#include "sample-format.hpp"
+#include "scan-table-cache.hpp"
+#include "sector-decoder.hpp"
+#include "spoke-queue.hpp"
+#include "spoke-throttle.hpp"
+#include "sweep-assembler.hpp"
+#include "thread-pool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Reads a comma separated list of sender stamps, such as "1,2". False if an entry is not a number or is repeated.
+bool parseSenderStamps(std::string const &list, std::vector<uint32_t> &stamps) noexcept;
+
+//One radar of the process, selected by the senderStamp of its envelopes. Every radar has its own queue, polar buffer,
+//image and published frames, named after it, and its own sweep assembler. The scan tables are not per radar: radars
+//drawn at the same range use the same tables, so a radar adds about its polar buffer and queue to the process.
+//The queue is filled by the receive thread and drained by one decode thread, which owns the decode fields. The
+//polar buffer and the range fields are guarded by polarMutex between the decode and render threads.
+struct RadarChannel {
+ private:
+  RadarChannel(const RadarChannel &) = delete;
+  RadarChannel(RadarChannel &&)      = delete;
+  RadarChannel &operator=(const RadarChannel &) = delete;
+  RadarChannel &operator=(RadarChannel &&) = delete;
+
+ public:
+  //The image is <name>.argb and the frames <name>.frames. The polar buffer takes the spokes and bins of tables, which
+  //draw the spokes until the radar reports a range. The queue is drained under the given overload policy, and the
+  //spokes hold samples of the given format.
+  RadarChannel(uint32_t senderStamp, std::string const &name, uint16_t c_width, uint16_t c_height, uint32_t buffers, uint32_t queueSlots, uint16_t sectorSpokes, std::shared_ptr<RangeTables const> tables, Overload overload = Overload::Off, SampleFormat format = SampleFormat::Byte) noexcept;
+
+  //Draws the spokes changed since the last render, or with all set every spoke, with the tables of the current range.
+  //The first render after a range switch clears the image and draws it whole. Draws nothing into an image segment
+  //that is not valid. Called with the image and polarMutex held.
+  void render(Palette const &palette, bool all, ThreadPool &pool) noexcept;
+
+  //Draws with the tables of another range from the next render on. The polar buffer starts over empty, as the
+  //spokes held were measured at the previous range. Called with polarMutex held.
+  void switchRange(std::shared_ptr<RangeTables const> tables) noexcept;
+
+  uint32_t const senderStamp;
+  std::string const name;
+  std::unique_ptr<cluon::SharedMemory> image;
+  FramePublisher frames;
+  SpokeQueue queue;
+  FrameMailbox mailbox;
+  //Set by the render thread when it wants the image while the sector decoders hold it.
+  std::atomic<bool> renderWanted;
+  //With --decoders above 1, the workers that write the image of this radar.
+  std::unique_ptr<SectorDecoder> sectorDecoder;
+
+  std::mutex polarMutex;
+  PolarBuffer polar;
+  std::shared_ptr<RangeTables const> tables;
+  std::unique_ptr<AggregateRenderer> aggregate;
+  uint32_t rangeSwitches;
+  uint32_t rangeDrawn;
+
+  //Decode thread. Overload policy, sample unpacking, render policy, sweeps, the progress published with the frames
+  //and whether the sector decoders hold the image.
+  SpokeThrottle throttle;
+  SpokeUnpacker unpacker;
+  SpokeCommit commit;
+  SweepAssembler sweeps;
+  RadarFrameStatus status;
+  bool imageHeld;
+  cluon::data::TimeStamp lastSpoke;
+  cluon::data::TimeStamp lastSweep;
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include <chrono>
 #include <math.h>
 #include <cmath>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
@@ -27,20 +28,42 @@
 #include "cluon-complete.hpp"
 #include "opendlv-standard-message-set.hpp"
 #include "radar-decoder.hpp"
+#include "spoke-kernel.hpp"
 
 
 #define radians(a) (((a)*M_PI)/180)
 
 using namespace std::chrono_literals;
 
+int decode (opendlv::proxy::RadarDetectionReading const &msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width) {
+  //Without a commit policy every spoke is signalled to the consumers.
+  SpokeCommit commit;
+  return decode(msg, shmArgb, table, verbose, origin, c_height, c_width, commit);
+}
 
+int decode (opendlv::proxy::RadarDetectionReading const &msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width, SpokeCommit &commit) {
+  static Palette const palette = defaultPalette();
+  return decode(msg, shmArgb, table, palette, verbose, origin, c_height, c_width, commit);
+}
 
-int decode (opendlv::proxy::RadarDetectionReading msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, uint16_t addBk[2048][512*2], bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width) {
+int decode (opendlv::proxy::RadarDetectionReading const &msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, Palette const &palette, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width, SpokeCommit &commit) {
+  //The generated message only hands out a copy of its payload. Keep it alive for the duration of the view. 
+  std::string const packet = msg.data();
+
+  SpokeView spoke;
+  spoke.data = reinterpret_cast<uint8_t const*>(packet.data());
+  spoke.length = uint32_t(packet.size());
+  spoke.azimuth = msg.azimuth();
+  spoke.range = msg.range();
+  return decode(spoke, shmArgb, table, palette, verbose, origin, c_height, c_width, commit);
+}
+
+int decode (SpokeView const &spoke, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, Palette const &palette, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width, SpokeCommit &commit) {
 
   ///Error handling
 
-  //msg
-  if (msg.data().size() == 0) {
+  //spoke
+  if (spoke.length == 0 || spoke.data == nullptr) {
       //empty packet
       if (verbose) std::cout << "Error: Empty Packet" << std::endl; 
       return(-1);
@@ -55,19 +78,19 @@ int decode (opendlv::proxy::RadarDetectionReading msg, std::unique_ptr<cluon::Sh
   }
   
   //c_height
-  if (c_height == NULL) {
+  if (c_height == 0) {
     if (verbose) std::cout << "Error: Canvas height is empty" << std::endl; 
     return (-3);
   }
 
   //c_width
-  if (c_width == NULL) {
+  if (c_width == 0) {
     if (verbose) std::cout << "Error: Canvas width is empty" << std::endl;
     return (-4);
   }
 
   //origin
-  if (origin == NULL) {
+  if (origin == 0) {
     if (verbose) std::cout << "Error: Canvas origin point is empty" << std::endl;
     return (-5);
   } else if (origin > c_width) {
@@ -78,93 +101,153 @@ int decode (opendlv::proxy::RadarDetectionReading msg, std::unique_ptr<cluon::Sh
     return (-7);
   }
 
-  if (msg.azimuth() == NULL) {
+  if (!(spoke.azimuth > 0)) {
     if (verbose) std::cout << "Error: Azimuth point is empty" << std::endl;
     return (-12);
-  } else if (msg.azimuth() > 4096) {
+  } else if (spoke.azimuth > 4096) {
     if (verbose) std::cout << "Error: Azimuth point is corrupted" << std::endl;
     return (-13); 
   }
   
-  uint8_t current_strength = 0;
+  //table
+  if (!table.valid() || table.width() > c_width) {
+    if (verbose) std::cout << "Error: Scan table exceeds canvas width" << std::endl;
+    return (-9);
+  }
+  if (table.height() > c_height) {
+    if (verbose) std::cout << "Error: Scan table exceeds canvas height" << std::endl;
+    return (-10);
+  }
+  if (table.canvasSize() > shmArgb->size()) {
+    if (verbose) std::cout << "Critical Error: Scan table exceeds memory bounds. This would lead to a SEGFAULT" << std::endl;
+    return (-11);
+  }
 
-  //Retrieve current angle, and set empty values for pixels and radians. 
+  if (verbose) std::cout << "Packet size: " << spoke.length << " Angle: " << spoke.azimuth << std::endl;
 
+  //The azimuth counts 4096 steps per revolution, spread over the spokes of the table.
+  uint32_t const index = uint32_t(spokeIndex(spoke, table.spokes(), false));
+  uint32_t const *offsets = table.spoke(index);
+  char *canvas = shmArgb->data();
 
-  double angle = msg.azimuth()/4096*360;
-  double angle_rad;
-  uint16_t x, y;
-  
-  //Extract the packet
-  std::string packet = msg.data();
-  
-  //If packet is empty, break lambda. 
-  if (packet.size() == 0) {
-    return (-8);
-  } 
-
-  if (verbose) std::cout << "Packet size: " << packet.size() << std::endl;
-  int k = 1;
-  //Process the packet. 
-  for (int i = 0; i < packet.size(); i = i+k) {
-    if (i > (packet.size()/3*2)) k = 2;
-    current_strength = packet[i];
-  
-    uint16_t distance = i;
-
-    //Retrieve x and y location values from the pixel map based on azimuth and distance.
-    x = addBk[int(msg.azimuth())/2][distance*2];
-    y = addBk[int(msg.azimuth())/2][(distance*2)+1];
-      
-    if (verbose) std::cout << "Angle: " << msg.azimuth() << " " << angle << " ";
-    if (verbose) std::cout << "Points: " << x << " " << y << " ";
-    
-    //Ensure x and y are valid
-    if (x > (c_width)) {
-      if (verbose) std::cout << "Error: X value exceeds canvas width" << std::endl;
-      return (-9);
-    }
-    if (y > (c_height)) {
-      if (verbose) std::cout << "Error: Y value exceeds canvas height" << std::endl;
-      return (-10);
-    }
+  //One byte per sample, as unpacked by SpokeUnpacker, up to the reach of the table. 
+  uint32_t const length = (spoke.length < table.reach()) ? spoke.length : table.reach();
 
-    if (verbose) std::cout << "Strength: " << std::to_string(current_strength) << " " << "Distance: " << distance << std::endl;
-    
-    //Use values from pixel map to get the image memory address for that pixel. 4 Bytes per pixel. X is *4, Y is *1024 (For the row) 
-  
-    uint32_t index = ((4*x)+(1024*y)*4);
-    shmArgb->lock();
+  //The whole spoke is written under a single lock. Locking, unlocking and notifying per sample costs a
+  //process-shared mutex round trip and a condition broadcast to every consumer for each of the 512 samples.
+  shmArgb->lock();
 
-    //Write the new values. White strength pixel, so all strengths are the same value. Set R, G or B to 255 for PPI color. 
-    //4th value is Alpha. Set as 0 for no transparency. 
+  //Every offset was checked against the canvas when the table was built, so the spoke goes straight to the vector
+  //kernel. 
+  scatterKernel()(canvas, offsets, spoke.data, length, palette.argb);
+  shmArgb->unlock();
 
-    if (index > shmArgb->size()) {
-        if (verbose) std::cout << "Critical Error: Lookup index exceeds memory bounds. This will lead to a SEGFAULT" << std::endl;
-        return(-11);
-    }
-
-    shmArgb->data()[index+2] = (current_strength);
-
-    if (current_strength == uint8_t(255)) { 
-      current_strength = uint8_t(0);
-    } else if (current_strength == 0) {
-      current_strength = 255;
-    }
-
-    shmArgb->data()[index+1] = (current_strength);              
-    shmArgb->data()[index] = (current_strength);
-    shmArgb->data()[index+3] = char(0);
-    
-    if (verbose) std::cout << "Index: " << index << ". Value " << std::to_string(shmArgb->data()[index]) << std::endl;
-
-    //Revalidate shared memory. 
-    shmArgb->unlock();
-    if (verbose) std::cout << shmArgb->valid() << std::endl;
+  //Signal the consumers once per spoke, or once per sector when the commit policy groups spokes. 
+  if (commitSector(commit, index)) {
     shmArgb->notifyAll();
-
   }
+
   //Spoke unpacked. Final validation
   if (verbose) std::cout << "Packet Validated: " << shmArgb->valid() << std::endl;
-  return (msg.azimuth());
-}
\ No newline at end of file
+  return (int(spoke.azimuth));
+}
+
+int spokeIndex(SpokeView const &spoke, uint16_t spokes, bool verbose) noexcept {
+  if (spoke.length == 0 || spoke.data == nullptr) {
+    if (verbose) std::cout << "Error: Empty Packet" << std::endl; 
+    return(-1);
+  }
+  //Azimuth 0 is north. Radars send 0 to 4095, so with one spoke per step spoke 0 is only reached from azimuth 0.
+  if (!(spoke.azimuth >= 0)) {
+    if (verbose) std::cout << "Error: Azimuth point is negative" << std::endl;
+    return (-12);
+  } else if (spoke.azimuth > 4096) {
+    if (verbose) std::cout << "Error: Azimuth point is corrupted" << std::endl;
+    return (-13); 
+  }
+  //For 2048 spokes this is azimuth/2, as in the Cartesian decoder.
+  return int((uint32_t(spoke.azimuth) * spokes / 4096) % spokes);
+}
+
+void writeRow(SpokeView const &spoke, uint8_t *row, uint16_t bins) noexcept {
+  //Same samples as the Cartesian decoder.
+  uint32_t const length = (spoke.length < bins) ? spoke.length : bins;
+  std::memcpy(row, spoke.data, length);
+}
+
+int decode (SpokeView const &spoke, PolarBuffer &polar, bool verbose) {
+  int const index = spokeIndex(spoke, polar.spokes(), verbose);
+  if (index < 0) return index;
+
+  writeRow(spoke, polar.row(uint32_t(index)), polar.bins());
+  polar.markDirty(uint32_t(index));
+
+  return (int(spoke.azimuth));
+}
+
+bool commitSector(SpokeCommit &commit, uint32_t spoke) noexcept {
+  int32_t const sector = int32_t(spoke / ((commit.sectorSpokes > 1) ? commit.sectorSpokes : 1));
+  if (commit.sectorSpokes == 1 || (commit.sectorSpokes > 1 && sector != commit.lastSector)) {
+    commit.lastSector = sector;
+    return true;
+  }
+  return false;
+}
+
+//Reads a little endian 32 bit float.
+static float readFloat(uint8_t const *bytes) {
+  uint32_t const raw = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+  float value;
+  std::memcpy(&value, &raw, 4);
+  return value;
+}
+
+//Reads a protobuf varint. Returns false if it runs past the end of the buffer.
+static bool readVarInt(uint8_t const *&it, uint8_t const *end, uint64_t &value) {
+  value = 0;
+  for (uint32_t shift = 0; it < end && shift < 64; shift += 7) {
+    uint8_t const b = *it++;
+    value |= uint64_t(b & 0x7f) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+bool extractSpoke(std::string const &serializedData, SpokeView &spoke) noexcept {
+  uint8_t const *it = reinterpret_cast<uint8_t const*>(serializedData.data());
+  uint8_t const *end = it + serializedData.size();
+
+  spoke = SpokeView();
+  while (it < end) {
+    uint64_t key;
+    if (!readVarInt(it, end, key)) return false;
+
+    uint64_t const field = key >> 3;
+    uint64_t const wireType = key & 0x7;
+    if (wireType == 5) {
+      //Four bytes: azimuth (1) and range (3).
+      if (end - it < 4) return false;
+      if (field == 1) spoke.azimuth = readFloat(it);
+      if (field == 3) spoke.range = readFloat(it);
+      it += 4;
+    } else if (wireType == 2) {
+      //Length delimited: data (2).
+      uint64_t length;
+      if (!readVarInt(it, end, length) || uint64_t(end - it) < length) return false;
+      if (field == 2) {
+        spoke.data = it;
+        spoke.length = uint32_t(length);
+      }
+      it += length;
+    } else if (wireType == 0) {
+      uint64_t ignored;
+      if (!readVarInt(it, end, ignored)) return false;
+    } else if (wireType == 1) {
+      if (end - it < 8) return false;
+      it += 8;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
@@ -18,11 +18,57 @@
 #ifndef RADAR_DECODER
 #define RADAR_DECODER
 
+#include "cluon-complete.hpp"
 #include "opendlv-standard-message-set.hpp"
+#include "palette.hpp"
+#include "polar-buffer.hpp"
+#include "scan-table.hpp"
 
+#include <memory>
 #include <string>
 #include <utility>
 
-int decode (opendlv::proxy::RadarDetectionReading msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, uint16_t addBk[2048][512*2], bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width);
+//Commit policy for decode. The shared memory is locked once per spoke, and the consumers waiting on it are
+//notified once per sector of sectorSpokes spokes (1 notifies on every spoke, 0 never). lastSector is updated by decode.
+struct SpokeCommit {
+  uint16_t sectorSpokes{1};
+  int32_t lastSector{-1};
+};
+
+//True if writing the given spoke completes a commit under the policy. Updates lastSector.
+bool commitSector(SpokeCommit &commit, uint32_t spoke) noexcept;
+
+//View of one spoke. data points at length bytes owned by the caller, one strength per byte once unpacked by
+//SpokeUnpacker. 
+struct SpokeView {
+  uint8_t const *data{nullptr};
+  uint32_t length{0};
+  float azimuth{0};
+  float range{0};
+};
+
+int decode (opendlv::proxy::RadarDetectionReading const &msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width);
+int decode (opendlv::proxy::RadarDetectionReading const &msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width, SpokeCommit &commit);
+int decode (opendlv::proxy::RadarDetectionReading const &msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, Palette const &palette, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width, SpokeCommit &commit);
+
+//Decodes one spoke straight from the caller's bytes. Does not allocate; the overloads above wrap this one.
+int decode (SpokeView const &spoke, std::unique_ptr<cluon::SharedMemory> &shmArgb, ScanTable const &table, Palette const &palette, bool verbose, uint16_t origin, uint16_t c_height, uint16_t c_width, SpokeCommit &commit);
+
+//Checks a spoke and returns its index in a sweep of the given number of spokes, with azimuths running 0 to 4096, or
+//the negative codes for an empty packet (-1) or a bad azimuth (-12, -13). Unlike the Cartesian decoder, which takes
+//azimuth 0 for an unset field, azimuth 0 is accepted as north.
+int spokeIndex(SpokeView const &spoke, uint16_t spokes, bool verbose) noexcept;
+
+//Copies the samples of a spoke, one byte each, into a row of bins strengths. Bins past the end of a short spoke keep
+//their previous value.
+void writeRow(SpokeView const &spoke, uint8_t *row, uint16_t bins) noexcept;
+
+//Stores one spoke in the polar buffer and marks it for rendering. Returns the azimuth, or the same negative codes as
+//the Cartesian decoder for an empty packet (-1) or a bad azimuth (-12, -13). Does not allocate.
+int decode (SpokeView const &spoke, PolarBuffer &polar, bool verbose);
+
+//Reads a serialized RadarDetectionReading in place. On success spoke.data points into serializedData, which must
+//outlive the view. Does not allocate.
+bool extractSpoke(std::string const &serializedData, SpokeView &spoke) noexcept;
 
 #endif
\ No newline at end of file
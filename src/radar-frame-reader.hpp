@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RADAR_FRAME_READER
+#define RADAR_FRAME_READER
+
+#include "cluon-complete.hpp"
+#include "radar-frame.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//Consumer side of the published frames segment, for use in other processes. Header only; it needs nothing from the
+//service but this header and radar-frame.hpp. Polling never takes the segment lock:
+//
+//  RadarFrameReader reader{"/polar0.frames"};
+//  std::vector<char> image(reader.frameBytes());
+//  RadarFrameStatus status;
+//  if (reader.poll(status) && reader.read(image.data())) { ... }
+class RadarFrameReader {
+ private:
+  RadarFrameReader(const RadarFrameReader &) = delete;
+  RadarFrameReader(RadarFrameReader &&)      = delete;
+  RadarFrameReader &operator=(const RadarFrameReader &) = delete;
+  RadarFrameReader &operator=(RadarFrameReader &&) = delete;
+
+ public:
+  //Attaches to the named segment.
+  explicit RadarFrameReader(std::string const &name) noexcept
+    : m_shm(new cluon::SharedMemory{name})
+    , m_segment(m_shm->valid() ? m_shm->data() : nullptr) {
+  }
+
+  //Reads a segment that is already mapped, given by its header.
+  explicit RadarFrameReader(RadarFrameHeader const *header) noexcept
+    : m_shm()
+    , m_segment(reinterpret_cast<char const*>(header)) {
+  }
+
+  bool valid() const noexcept {
+    return m_segment != nullptr && header().magic == RADAR_FRAME_MAGIC;
+  }
+
+  uint16_t width() const noexcept {
+    return valid() ? header().width : 0;
+  }
+
+  uint16_t height() const noexcept {
+    return valid() ? header().height : 0;
+  }
+
+  uint32_t frameBytes() const noexcept {
+    return valid() ? header().frameBytes : 0;
+  }
+
+  //Latest status, consistent across its fields.
+  bool status(RadarFrameStatus &status) const noexcept {
+    return valid() && readFrameStatus(header(), status);
+  }
+
+  //Latest status, and true if a frame was published since the last read().
+  bool poll(RadarFrameStatus &status) const noexcept {
+    return this->status(status) && status.frame > m_lastFrame;
+  }
+
+  //Copies the latest frame into image, which must hold frameBytes(). Frame number and time of the copy are kept.
+  bool read(char *image) noexcept {
+    if (!valid()) return false;
+    uint64_t sequence;
+    int64_t timestamp;
+    if (!readLatestFrame(m_segment, image, sequence, timestamp)) return false;
+    m_lastFrame = sequence;
+    m_lastTimestamp = timestamp;
+    return true;
+  }
+
+  uint64_t lastFrame() const noexcept {
+    return m_lastFrame;
+  }
+
+  int64_t lastTimestamp() const noexcept {
+    return m_lastTimestamp;
+  }
+
+ private:
+  RadarFrameHeader const &header() const noexcept {
+    return *reinterpret_cast<RadarFrameHeader const*>(m_segment);
+  }
+
+  std::unique_ptr<cluon::SharedMemory> m_shm;
+  char const *m_segment;
+  uint64_t m_lastFrame{0};
+  int64_t m_lastTimestamp{0};
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RADAR_FRAME
+#define RADAR_FRAME
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+//Layout of the published frames segment, shared with consumers in other processes. The segment starts with a
+//RadarFrameHeader; frame i is frameBytes of 4 byte per pixel image starting at dataOffset + i * frameBytes.
+//The writer fills a frame that is not the latest, then makes it the latest, so readers never need the lock.
+
+static uint32_t const RADAR_FRAME_MAGIC = 0x52464d32;
+static uint32_t const RADAR_FRAME_MAX_BUFFERS = 4;
+
+//One frame buffer. version is odd while the writer fills the buffer and is bumped again when it is done.
+struct RadarFrameSlot {
+  std::atomic<uint32_t> version;
+  uint32_t reserved;
+  std::atomic<uint64_t> sequence;
+  std::atomic<int64_t> timestamp;
+};
+
+//Progress of the radar, as plain values. sweep counts completed revolutions and sweepTimestamp is the time the
+//current one started, in microseconds. lastAzimuth is the latest spoke written. dirtyBegin to dirtyEnd is the
+//inclusive range of spokes changed since the previous frame, in sweep order, so dirtyBegin > dirtyEnd when it wraps
+//past north. frame is the number of the latest published frame.
+struct RadarFrameStatus {
+  uint64_t sweep{0};
+  int64_t sweepTimestamp{0};
+  float lastAzimuth{0};
+  uint16_t dirtyBegin{0};
+  uint16_t dirtyEnd{0};
+  uint64_t frame{0};
+};
+
+struct RadarFrameHeader {
+  uint32_t magic;
+  uint16_t width;
+  uint16_t height;
+  uint32_t buffers;
+  uint32_t frameBytes;
+  uint32_t dataOffset;
+  //Index of the latest complete frame.
+  std::atomic<uint32_t> latest;
+  RadarFrameSlot slots[RADAR_FRAME_MAX_BUFFERS];
+
+  //Status under a seqlock: odd while the writer updates it.
+  std::atomic<uint32_t> seqlock;
+  std::atomic<uint64_t> sweep;
+  std::atomic<int64_t> sweepTimestamp;
+  std::atomic<float> lastAzimuth;
+  std::atomic<uint32_t> dirtyRange;
+  std::atomic<uint64_t> frame;
+};
+
+//Writes the status under the seqlock. Single writer.
+inline void writeFrameStatus(RadarFrameHeader &header, RadarFrameStatus const &status) noexcept {
+  uint32_t const sequence = header.seqlock.load(std::memory_order_relaxed);
+  header.seqlock.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header.sweep.store(status.sweep, std::memory_order_relaxed);
+  header.sweepTimestamp.store(status.sweepTimestamp, std::memory_order_relaxed);
+  header.lastAzimuth.store(status.lastAzimuth, std::memory_order_relaxed);
+  header.dirtyRange.store(uint32_t(status.dirtyBegin) | (uint32_t(status.dirtyEnd) << 16), std::memory_order_relaxed);
+  header.frame.store(status.frame, std::memory_order_relaxed);
+  header.seqlock.store(sequence + 2, std::memory_order_release);
+}
+
+//Reads a consistent status without locking. Returns false if the writer kept it busy for every attempt.
+inline bool readFrameStatus(RadarFrameHeader const &header, RadarFrameStatus &status) noexcept {
+  for (uint32_t attempt = 0; attempt < 64; attempt++) {
+    uint32_t const before = header.seqlock.load(std::memory_order_acquire);
+    if ((before & 1) != 0) continue;
+    status.sweep = header.sweep.load(std::memory_order_relaxed);
+    status.sweepTimestamp = header.sweepTimestamp.load(std::memory_order_relaxed);
+    status.lastAzimuth = header.lastAzimuth.load(std::memory_order_relaxed);
+    uint32_t const range = header.dirtyRange.load(std::memory_order_relaxed);
+    status.dirtyBegin = uint16_t(range & 0xffff);
+    status.dirtyEnd = uint16_t(range >> 16);
+    status.frame = header.frame.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header.seqlock.load(std::memory_order_relaxed) == before) return true;
+  }
+  return false;
+}
+
+//Copies the latest complete frame of a mapped segment into out, which must hold frameBytes. sequence is the frame
+//number, counting from 1, and timestamp its time in microseconds. Returns false if the segment holds no frame yet or
+//the writer overtook the copy too often.
+inline bool readLatestFrame(char const *segment, char *out, uint64_t &sequence, int64_t &timestamp) noexcept {
+  RadarFrameHeader const *header = reinterpret_cast<RadarFrameHeader const*>(segment);
+  if (header->magic != RADAR_FRAME_MAGIC) return false;
+  for (uint32_t attempt = 0; attempt < 8; attempt++) {
+    uint32_t const index = header->latest.load(std::memory_order_acquire) % RADAR_FRAME_MAX_BUFFERS;
+    RadarFrameSlot const &slot = header->slots[index];
+    uint32_t const before = slot.version.load(std::memory_order_acquire);
+    if (before == 0 || (before & 1) != 0) continue;
+    std::memcpy(out, segment + header->dataOffset + size_t(index) * header->frameBytes, header->frameBytes);
+    sequence = slot.sequence.load(std::memory_order_relaxed);
+    timestamp = slot.timestamp.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) == before) return true;
+  }
+  return false;
+}
+
+#endif
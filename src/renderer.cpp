@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "renderer.hpp"
+#include "spoke-kernel.hpp"
+
+uint32_t renderDirty(PolarBuffer &polar, ScanTable const &table, Palette const &palette, char *canvas) noexcept {
+  uint32_t rendered = 0;
+  ScatterKernel const kernel = scatterKernel();
+  for (uint32_t spoke = 0; spoke < polar.spokes() && polar.dirtyCount() > 0; spoke++) {
+    if (polar.dirty(spoke)) {
+      kernel(canvas, table.spoke(spoke), polar.row(spoke), table.reach(), palette.argb);
+      polar.clearDirty(spoke);
+      rendered++;
+    }
+  }
+  return rendered;
+}
+
+uint32_t renderAll(PolarBuffer &polar, ScanTable const &table, Palette const &palette, char *canvas) noexcept {
+  ScatterKernel const kernel = scatterKernel();
+  for (uint32_t spoke = 0; spoke < polar.spokes(); spoke++) {
+    kernel(canvas, table.spoke(spoke), polar.row(spoke), table.reach(), palette.argb);
+    polar.clearDirty(spoke);
+  }
+  return polar.spokes();
+}
+
+void renderInverse(PolarBuffer &polar, InverseScanTable const &table, Palette const &palette, char *canvas, ThreadPool &pool) noexcept {
+  uint8_t const *strengths = polar.data();
+  uint32_t const stride = uint32_t(table.width()) * 4;
+  pool.parallelFor(0, table.height(), [&](uint32_t begin, uint32_t end) {
+    for (uint32_t y = begin; y < end; y++) {
+      uint32_t const *sources = table.row(y);
+      char *pixels = canvas + y * stride;
+      for (uint32_t x = table.rowBegin(y); x < table.rowEnd(y); x++) {
+        std::memcpy(pixels + x * 4, &palette.argb[strengths[sources[x]]], 4);
+      }
+    }
+  });
+  polar.clearAllDirty();
+}
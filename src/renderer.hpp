@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RENDERER
+#define RENDERER
+
+#include <cstdint>
+
+#include "palette.hpp"
+#include "polar-buffer.hpp"
+#include "scan-table.hpp"
+#include "thread-pool.hpp"
+
+//Forward renderer. Scatters the spokes of the polar buffer that changed since the last render into the canvas and
+//marks them clean. The table must match the polar buffer geometry and fit the canvas. Bins past the reach of the
+//table are not drawn. Returns the spokes rendered.
+uint32_t renderDirty(PolarBuffer &polar, ScanTable const &table, Palette const &palette, char *canvas) noexcept;
+
+//Renders every spoke, dirty or not, and marks them clean.
+uint32_t renderAll(PolarBuffer &polar, ScanTable const &table, Palette const &palette, char *canvas) noexcept;
+
+//Inverse renderer. Gathers every pixel in range from its polar source, so the image has no holes at long range and
+//each pixel is written once. Rows are split across the pool. Pixels out of range are left untouched. The table must
+//match the polar buffer geometry and fit the canvas. Marks every spoke clean.
+void renderInverse(PolarBuffer &polar, InverseScanTable const &table, Palette const &palette, char *canvas, ThreadPool &pool) noexcept;
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include "sample-format.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAMPLE_FORMAT_X86
+#include <immintrin.h>
+#endif
+
+bool parseSampleFormat(std::string const &name, SampleFormat &format) noexcept {
+  if (name == "8bit") format = SampleFormat::Byte;
+  else if (name == "4bit") format = SampleFormat::Nibble;
+  else if (name == "4bit-high") format = SampleFormat::NibbleHighFirst;
+  else return false;
+  return true;
+}
+
+char const *sampleFormatName(SampleFormat format) noexcept {
+  switch (format) {
+    case SampleFormat::Nibble: return "4bit";
+    case SampleFormat::NibbleHighFirst: return "4bit-high";
+    default: return "8bit";
+  }
+}
+
+uint32_t sampleCount(SampleFormat format, uint32_t bytes) noexcept {
+  return (format == SampleFormat::Byte) ? bytes : bytes * 2;
+}
+
+void unpackScalar(uint8_t const *packed, uint32_t count, uint8_t *samples, bool highFirst) noexcept {
+  uint32_t const first = highFirst ? 4 : 0;
+  uint32_t const second = highFirst ? 0 : 4;
+  uint32_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    uint8_t const byte = packed[i / 2];
+    samples[i] = uint8_t(((byte >> first) & 0x0F) * 17);
+    samples[i + 1] = uint8_t(((byte >> second) & 0x0F) * 17);
+  }
+  if (i < count) samples[i] = uint8_t(((packed[i / 2] >> first) & 0x0F) * 17);
+}
+
+static void unpackLowScalar(uint8_t const *packed, uint32_t count, uint8_t *samples) noexcept {
+  unpackScalar(packed, count, samples, false);
+}
+
+static void unpackHighScalar(uint8_t const *packed, uint32_t count, uint8_t *samples) noexcept {
+  unpackScalar(packed, count, samples, true);
+}
+
+#ifdef SAMPLE_FORMAT_X86
+
+//As with the scatter kernels, the vector kernels are compiled for their instruction set with target attributes and
+//only selected when the CPU supports it. Each nibble is scaled with a 16 entry byte shuffle, and the two nibbles of a
+//byte are interleaved back into sample order.
+
+__attribute__((target("sse4.1")))
+static inline void unpackSse41(uint8_t const *packed, uint32_t count, uint8_t *samples, bool highFirst) noexcept {
+  __m128i const scale = _mm_setr_epi8(0, 17, 34, 51, 68, 85, 102, 119, char(136), char(153), char(170), char(187), char(204), char(221), char(238), char(255));
+  __m128i const mask = _mm_set1_epi8(0x0F);
+  uint32_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(packed + i / 2));
+    __m128i const low = _mm_shuffle_epi8(scale, _mm_and_si128(bytes, mask));
+    __m128i const high = _mm_shuffle_epi8(scale, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    __m128i const first = highFirst ? high : low;
+    __m128i const second = highFirst ? low : high;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_unpacklo_epi8(first, second));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i + 16), _mm_unpackhi_epi8(first, second));
+  }
+  unpackScalar(packed + i / 2, count - i, samples + i, highFirst);
+}
+
+__attribute__((target("sse4.1")))
+static void unpackLowSse41(uint8_t const *packed, uint32_t count, uint8_t *samples) noexcept {
+  unpackSse41(packed, count, samples, false);
+}
+
+__attribute__((target("sse4.1")))
+static void unpackHighSse41(uint8_t const *packed, uint32_t count, uint8_t *samples) noexcept {
+  unpackSse41(packed, count, samples, true);
+}
+
+//64 samples per iteration. The byte shuffles and interleaves work within 128 bit lanes, so the two halves are put
+//back in order with a lane permute.
+__attribute__((target("avx2")))
+static inline void unpackAvx2(uint8_t const *packed, uint32_t count, uint8_t *samples, bool highFirst) noexcept {
+  __m256i const scale = _mm256_setr_epi8(0, 17, 34, 51, 68, 85, 102, 119, char(136), char(153), char(170), char(187), char(204), char(221), char(238), char(255),
+                                         0, 17, 34, 51, 68, 85, 102, 119, char(136), char(153), char(170), char(187), char(204), char(221), char(238), char(255));
+  __m256i const mask = _mm256_set1_epi8(0x0F);
+  uint32_t i = 0;
+  for (; i + 64 <= count; i += 64) {
+    __m256i const bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(packed + i / 2));
+    __m256i const low = _mm256_shuffle_epi8(scale, _mm256_and_si256(bytes, mask));
+    __m256i const high = _mm256_shuffle_epi8(scale, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+    __m256i const first = highFirst ? high : low;
+    __m256i const second = highFirst ? low : high;
+    __m256i const a = _mm256_unpacklo_epi8(first, second);
+    __m256i const b = _mm256_unpackhi_epi8(first, second);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(samples + i), _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(samples + i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+  }
+  unpackScalar(packed + i / 2, count - i, samples + i, highFirst);
+}
+
+__attribute__((target("avx2")))
+static void unpackLowAvx2(uint8_t const *packed, uint32_t count, uint8_t *samples) noexcept {
+  unpackAvx2(packed, count, samples, false);
+}
+
+__attribute__((target("avx2")))
+static void unpackHighAvx2(uint8_t const *packed, uint32_t count, uint8_t *samples) noexcept {
+  unpackAvx2(packed, count, samples, true);
+}
+
+#endif
+
+UnpackKernel unpackKernel(SampleFormat format, KernelLevel level) noexcept {
+  if (format == SampleFormat::Byte) return nullptr;
+  bool const highFirst = (format == SampleFormat::NibbleHighFirst);
+  KernelLevel const supported = detectKernelLevel();
+  if (int(level) > int(supported)) level = supported;
+#ifdef SAMPLE_FORMAT_X86
+  if (level == KernelLevel::Avx2) return highFirst ? unpackHighAvx2 : unpackLowAvx2;
+  if (level == KernelLevel::Sse41) return highFirst ? unpackHighSse41 : unpackLowSse41;
+#endif
+  return highFirst ? unpackHighScalar : unpackLowScalar;
+}
+
+UnpackKernel unpackKernel(SampleFormat format) noexcept {
+  static KernelLevel const level = detectKernelLevel();
+  return unpackKernel(format, level);
+}
+
+SpokeUnpacker::SpokeUnpacker(SampleFormat format, uint16_t bins) noexcept
+  : m_format(format)
+  , m_kernel(unpackKernel(format))
+  , m_samples((format == SampleFormat::Byte) ? 0 : bins, 0) {
+}
+
+SampleFormat SpokeUnpacker::format() const noexcept {
+  return m_format;
+}
+
+SpokeView SpokeUnpacker::unpack(SpokeView const &spoke) noexcept {
+  if (m_kernel == nullptr || spoke.data == nullptr) return spoke;
+  uint32_t const count = std::min<uint32_t>(sampleCount(m_format, spoke.length), uint32_t(m_samples.size()));
+  m_kernel(spoke.data, count, m_samples.data());
+  SpokeView samples = spoke;
+  samples.data = m_samples.data();
+  samples.length = count;
+  return samples;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SAMPLE_FORMAT
+#define SAMPLE_FORMAT
+
+#include "radar-decoder.hpp"
+#include "spoke-kernel.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Encoding of the samples in a spoke. Byte holds one 8 bit sample per byte. Nibble packs two 4 bit samples per byte,
+//the low nibble first, as Navico radars send them; NibbleHighFirst takes the high nibble first.
+enum class SampleFormat : uint8_t {
+  Byte,
+  Nibble,
+  NibbleHighFirst
+};
+
+//Reads 8bit, 4bit or 4bit-high. False for anything else.
+bool parseSampleFormat(std::string const &name, SampleFormat &format) noexcept;
+char const *sampleFormatName(SampleFormat format) noexcept;
+
+//Samples held in a spoke of the given number of bytes.
+uint32_t sampleCount(SampleFormat format, uint32_t bytes) noexcept;
+
+//Unpack kernel. Widens the first count 4 bit samples of packed to one byte each, scaled from 0 to 15 up to 0 to 255
+//so the palette sees the full range. packed must hold (count + 1) / 2 bytes.
+typedef void (*UnpackKernel)(uint8_t const *packed, uint32_t count, uint8_t *samples);
+
+//Reference implementation. The vector kernels must produce the same samples bit for bit.
+void unpackScalar(uint8_t const *packed, uint32_t count, uint8_t *samples, bool highFirst) noexcept;
+
+//Kernel for a 4 bit format at the given level, or the highest supported level below it. Null for Byte.
+UnpackKernel unpackKernel(SampleFormat format, KernelLevel level) noexcept;
+
+//Kernel for a 4 bit format at the highest level supported by this CPU.
+UnpackKernel unpackKernel(SampleFormat format) noexcept;
+
+//Turns spokes of a sample format into one byte per sample for the decoders. 4 bit spokes are unpacked into a buffer
+//allocated once, so a spoke of n bytes gives 2n bins for the same bandwidth. Owned by one decode thread.
+class SpokeUnpacker {
+ public:
+  //bins is the most samples kept of a spoke.
+  SpokeUnpacker(SampleFormat format = SampleFormat::Byte, uint16_t bins = 512) noexcept;
+
+  SampleFormat format() const noexcept;
+
+  //View of the spoke with one byte per sample, at most bins of them for 4 bit spokes. 8 bit spokes are passed
+  //through; otherwise the view points into the buffer and is valid until the next call.
+  SpokeView unpack(SpokeView const &spoke) noexcept;
+
+ private:
+  SampleFormat m_format;
+  UnpackKernel m_kernel;
+  std::vector<uint8_t> m_samples;
+};
+
+#endif
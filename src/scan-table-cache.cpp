@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "scan-table-cache.hpp"
+
+RangeTables::RangeTables(ScanTable table, uint32_t range, bool inverse, Aggregation aggregation) noexcept
+  : m_range(range)
+  , m_table(std::move(table))
+  , m_bounds(m_table)
+  , m_inverse()
+  , m_fanIn()
+  , m_aggregation(inverse ? Aggregation::Last : aggregation) {
+  if (inverse) {
+    m_inverse.reset(new InverseScanTable{m_table.origin(), m_table.width(), m_table.height(), m_table.spokes(), m_table.bins(), m_table.pixelsPerBin()});
+  } else if (aggregation != Aggregation::Last) {
+    m_fanIn.reset(new FanInTable{m_table});
+  }
+}
+
+uint32_t RangeTables::range() const noexcept {
+  return m_range;
+}
+
+ScanTable const &RangeTables::table() const noexcept {
+  return m_table;
+}
+
+SpokeBounds const &RangeTables::bounds() const noexcept {
+  return m_bounds;
+}
+
+InverseScanTable const *RangeTables::inverse() const noexcept {
+  return m_inverse.get();
+}
+
+FanInTable const *RangeTables::fanIn() const noexcept {
+  return m_fanIn.get();
+}
+
+Aggregation RangeTables::aggregation() const noexcept {
+  return m_aggregation;
+}
+
+ScanTableCache::ScanTableCache(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins,
+    float metersPerPixel, uint32_t capacity, bool inverse, Aggregation aggregation) noexcept
+  : m_origin(origin)
+  , m_width(c_width)
+  , m_height(c_height)
+  , m_spokes(spokes)
+  , m_bins(bins)
+  , m_metersPerPixel(metersPerPixel)
+  , m_capacity((capacity > 0) ? capacity : 1)
+  , m_inverse(inverse)
+  , m_aggregation(aggregation) {
+}
+
+std::shared_ptr<RangeTables const> ScanTableCache::find(uint32_t meters) noexcept {
+  for (size_t i = 0; i < m_entries.size(); i++) {
+    if (m_entries[i]->range() == meters) {
+      //Move to the front, keeping the order of the others.
+      std::rotate(m_entries.begin(), m_entries.begin() + long(i), m_entries.begin() + long(i) + 1);
+      return m_entries.front();
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<RangeTables const> ScanTableCache::tables(float range) noexcept {
+  if (!(range > 0)) return nullptr;
+  uint32_t const meters = uint32_t(std::lround(range));
+  if (meters == 0) return nullptr;
+
+  double metersPerPixel;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<RangeTables const> kept = find(meters);
+    if (kept) {
+      m_hits++;
+      return kept;
+    }
+    //The last bin of the first range lands at the nearest edge of the canvas.
+    if (!(m_metersPerPixel > 0)) m_metersPerPixel = double(meters) / (std::min(m_width, m_height) / 2.0);
+    metersPerPixel = m_metersPerPixel;
+  }
+
+  //Built without the lock, as it takes tens of milliseconds, so lookups of kept ranges do not wait for it.
+  float const pixelsPerBin = float((double(meters) / m_bins) / metersPerPixel);
+  std::shared_ptr<RangeTables const> built{std::make_shared<RangeTables>(ScanTable{OctantTable{m_spokes, m_bins, pixelsPerBin}, m_origin, m_width, m_height}, meters, m_inverse, m_aggregation)};
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  //Another radar may have built the same range meanwhile; all of them draw with the kept one.
+  std::shared_ptr<RangeTables const> kept = find(meters);
+  if (kept) return kept;
+  if (m_entries.size() >= m_capacity) m_entries.pop_back();
+  m_entries.emplace(m_entries.begin(), std::move(built));
+  m_builds++;
+  return m_entries.front();
+}
+
+float ScanTableCache::metersPerPixel() const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return float(m_metersPerPixel);
+}
+
+uint32_t ScanTableCache::capacity() const noexcept {
+  return m_capacity;
+}
+
+uint32_t ScanTableCache::size() const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return uint32_t(m_entries.size());
+}
+
+uint32_t ScanTableCache::hits() const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hits;
+}
+
+uint32_t ScanTableCache::builds() const noexcept {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_builds;
+}
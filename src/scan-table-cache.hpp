@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SCAN_TABLE_CACHE
+#define SCAN_TABLE_CACHE
+
+#include "aggregate-renderer.hpp"
+#include "dirty-region.hpp"
+#include "scan-table.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//Tables used to draw one range scale: the forward table with its spoke bounds, and the inverse table or the fan-in
+//of the aggregate renderers when they are in use. They are not changed after they are built, so every radar drawn at
+//the range uses the same ones.
+class RangeTables {
+ private:
+  RangeTables(const RangeTables &) = delete;
+  RangeTables(RangeTables &&)      = delete;
+  RangeTables &operator=(const RangeTables &) = delete;
+  RangeTables &operator=(RangeTables &&) = delete;
+
+ public:
+  //With inverse set the inverse table is built at the scale of table; otherwise an aggregation other than Last builds
+  //the fan-in of the table.
+  RangeTables(ScanTable table, uint32_t range, bool inverse, Aggregation aggregation) noexcept;
+
+  //Range in meters covered by the bins of a spoke, 0 for the unscaled tables.
+  uint32_t range() const noexcept;
+  ScanTable const &table() const noexcept;
+  SpokeBounds const &bounds() const noexcept;
+  InverseScanTable const *inverse() const noexcept;
+  FanInTable const *fanIn() const noexcept;
+  Aggregation aggregation() const noexcept;
+
+ private:
+  uint32_t m_range;
+  ScanTable m_table;
+  SpokeBounds m_bounds;
+  std::unique_ptr<InverseScanTable> m_inverse;
+  std::unique_ptr<FanInTable> m_fanIn;
+  Aggregation m_aggregation;
+};
+
+//Tables per range scale at a fixed display scale, so the image keeps its size when the radar changes range. Each
+//range is built the first time it is asked for and kept, up to capacity ranges; beyond that the least recently used
+//range is dropped. Switching back to a kept range is a lookup. A dropped range lives on until the last radar drawing
+//with it lets go. Safe to use from several threads.
+class ScanTableCache {
+ private:
+  ScanTableCache(const ScanTableCache &) = delete;
+  ScanTableCache(ScanTableCache &&)      = delete;
+  ScanTableCache &operator=(const ScanTableCache &) = delete;
+  ScanTableCache &operator=(ScanTableCache &&) = delete;
+
+ public:
+  //With metersPerPixel 0 the first range asked for sets the scale, drawing its last bin at the nearest edge of the
+  //canvas, half its width or height from the centre.
+  ScanTableCache(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes = 2048, uint16_t bins = 512,
+      float metersPerPixel = 0.0f, uint32_t capacity = 4, bool inverse = false, Aggregation aggregation = Aggregation::Last) noexcept;
+
+  //Tables for a range in meters, rounded to whole meters, or empty for a range that rounds to 0. A range that is not
+  //kept is built by the calling thread without holding the cache.
+  std::shared_ptr<RangeTables const> tables(float range) noexcept;
+
+  float metersPerPixel() const noexcept;
+  uint32_t capacity() const noexcept;
+  uint32_t size() const noexcept;
+  uint32_t hits() const noexcept;
+  uint32_t builds() const noexcept;
+
+ private:
+  //The kept tables of a range moved to the front, or empty. Called with the mutex held.
+  std::shared_ptr<RangeTables const> find(uint32_t meters) noexcept;
+
+  uint16_t m_origin;
+  uint16_t m_width;
+  uint16_t m_height;
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  double m_metersPerPixel;
+  uint32_t m_capacity;
+  bool m_inverse;
+  Aggregation m_aggregation;
+  mutable std::mutex m_mutex{};
+  //Most recently used first.
+  std::vector<std::shared_ptr<RangeTables const>> m_entries{};
+  uint32_t m_hits{0};
+  uint32_t m_builds{0};
+};
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "scan-table.hpp"
+
+//Expands the bins of one spoke into byte offsets, with the row stride of the canvas and the mirroring of the octant
+//as constants.
+template <int32_t Stride, int32_t XSign, int32_t YSign>
+static void expandSpoke(uint32_t *offsets, int16_t const *x, int16_t const *y, uint32_t reach, int32_t base) noexcept {
+  for (uint32_t j = 0; j < reach; j++) {
+    offsets[j] = uint32_t(base + XSign * 4 * x[j] - YSign * Stride * y[j]);
+  }
+}
+
+template <int32_t Stride>
+static void expandSpoke(uint32_t *offsets, int16_t const *x, int16_t const *y, int32_t xSign, int32_t ySign, uint32_t reach, int32_t base) noexcept {
+  if (xSign > 0) {
+    if (ySign > 0) expandSpoke<Stride, 1, 1>(offsets, x, y, reach, base);
+    else expandSpoke<Stride, 1, -1>(offsets, x, y, reach, base);
+  } else {
+    if (ySign > 0) expandSpoke<Stride, -1, 1>(offsets, x, y, reach, base);
+    else expandSpoke<Stride, -1, -1>(offsets, x, y, reach, base);
+  }
+}
+
+//Any other canvas width, with the stride taken at run time.
+static void expandSpoke(uint32_t *offsets, int16_t const *x, int16_t const *y, int32_t xSign, int32_t ySign, uint32_t reach, int32_t base, int32_t stride) noexcept {
+  int32_t const xStep = xSign * 4;
+  int32_t const yStep = -ySign * stride;
+  for (uint32_t j = 0; j < reach; j++) {
+    offsets[j] = uint32_t(base + xStep * x[j] + yStep * y[j]);
+  }
+}
+
+OctantTable::OctantTable(uint16_t spokes, uint16_t bins, float pixelsPerBin) noexcept
+  : m_spokes(spokes)
+  , m_bins(bins)
+  , m_pixelsPerBin(pixelsPerBin)
+  , m_octant(spokes % 8 == 0)
+  , m_dx()
+  , m_dy() {
+
+  //Spokes 0 to spokes/8 inclusive cover 0 to 45 degrees.
+  uint32_t const stored = m_octant ? (m_spokes / 8 + 1) : m_spokes;
+  m_dx.resize(stored * m_bins);
+  m_dy.resize(stored * m_bins);
+
+  //Spoke 0 points up (north) and the spokes turn clockwise. One sin and cos per spoke.
+  for (uint32_t i = 0; i < stored; i++) {
+    double const angle_rad = (2 * M_PI * i) / m_spokes;
+    double const s = std::sin(angle_rad) * m_pixelsPerBin;
+    double const c = std::cos(angle_rad) * m_pixelsPerBin;
+    for (uint32_t j = 0; j < m_bins; j++) {
+      m_dx[i * m_bins + j] = int16_t(std::lround(s * j));
+      m_dy[i * m_bins + j] = int16_t(std::lround(c * j));
+    }
+  }
+}
+
+uint16_t OctantTable::spokes() const noexcept {
+  return m_spokes;
+}
+
+uint16_t OctantTable::bins() const noexcept {
+  return m_bins;
+}
+
+float OctantTable::pixelsPerBin() const noexcept {
+  return m_pixelsPerBin;
+}
+
+uint32_t OctantTable::size() const noexcept {
+  return uint32_t((m_dx.size() + m_dy.size()) * sizeof(int16_t));
+}
+
+void OctantTable::symmetry(uint32_t spoke, int16_t const *&x, int16_t const *&y, int32_t &xSign, int32_t &ySign) const noexcept {
+  if (!m_octant) {
+    x = m_dx.data() + spoke * m_bins;
+    y = m_dy.data() + spoke * m_bins;
+    xSign = 1;
+    ySign = 1;
+    return;
+  }
+
+  //Within a quadrant, angles past 45 degrees mirror the first octant with sin and cos swapped.
+  uint32_t const quarter = m_spokes / 4;
+  uint32_t const quadrant = (spoke / quarter) % 4;
+  uint32_t const t = spoke % quarter;
+  int16_t const *a;
+  int16_t const *b;
+  if (t <= quarter / 2) {
+    a = m_dx.data() + t * m_bins;
+    b = m_dy.data() + t * m_bins;
+  } else {
+    a = m_dy.data() + (quarter - t) * m_bins;
+    b = m_dx.data() + (quarter - t) * m_bins;
+  }
+
+  //Each quadrant turns the first one by another 90 degrees clockwise: (dx, dy) becomes (dy, -dx).
+  switch (quadrant) {
+    case 0: x = a; y = b; xSign = 1; ySign = 1; break;
+    case 1: x = b; y = a; xSign = 1; ySign = -1; break;
+    case 2: x = a; y = b; xSign = -1; ySign = -1; break;
+    default: x = b; y = a; xSign = -1; ySign = 1; break;
+  }
+}
+
+void OctantTable::displacement(uint32_t spoke, uint32_t bin, int32_t &dx, int32_t &dy) const noexcept {
+  int16_t const *x;
+  int16_t const *y;
+  int32_t xSign;
+  int32_t ySign;
+  symmetry(spoke, x, y, xSign, ySign);
+  dx = xSign * x[bin];
+  dy = ySign * y[bin];
+}
+
+ScanTable::ScanTable(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins) noexcept
+  : ScanTable(OctantTable{spokes, bins}, origin, c_width, c_height) {
+}
+
+ScanTable::ScanTable(OctantTable const &octant, uint16_t origin, uint16_t c_width, uint16_t c_height, uint32_t *storage) noexcept
+  : m_origin(origin)
+  , m_width(c_width)
+  , m_height(c_height)
+  , m_spokes(octant.spokes())
+  , m_bins(octant.bins())
+  , m_reach(octant.bins())
+  , m_pixelsPerBin(octant.pixelsPerBin())
+  , m_valid(octant.spokes() > 0 && octant.bins() > 0)
+  , m_offsets(storage == nullptr ? uint32_t(octant.spokes()) * octant.bins() : 0)
+  , m_external(storage) {
+
+  uint32_t *out = (storage == nullptr) ? m_offsets.data() : storage;
+
+  //A scaled table is cut at the largest circle around the origin that fits the canvas. The displacement of a bin
+  //is at most its rounded distance, on every spoke.
+  if (m_pixelsPerBin < 1.0f || m_pixelsPerBin > 1.0f) {
+    int32_t const radius = std::min({int32_t(m_origin), int32_t(m_width) - 1 - m_origin, int32_t(m_height) - 1 - m_origin});
+    while (m_reach > 0 && std::lround((m_reach - 1) * double(m_pixelsPerBin)) > radius) m_reach--;
+    m_valid = m_valid && m_reach > 0;
+  }
+
+  int32_t const stride = int32_t(m_width) * 4;
+  int32_t const base = int32_t(m_origin) * 4 + int32_t(m_origin) * stride;
+
+  for (uint32_t i = 0; i < m_spokes && m_valid; i++) {
+    int16_t const *x;
+    int16_t const *y;
+    int32_t xSign;
+    int32_t ySign;
+    octant.symmetry(i, x, y, xSign, ySign);
+
+    //The displacement grows with the bin, so the last bin is the only one that can leave the canvas.
+    int32_t const xLast = int32_t(m_origin) + xSign * x[m_reach - 1];
+    int32_t const yLast = int32_t(m_origin) - ySign * y[m_reach - 1];
+    if (xLast < 0 || yLast < 0 || xLast >= m_width || yLast >= m_height) {
+      m_valid = false;
+      break;
+    }
+
+    //Branch free expansion of one spoke, left to the compiler to vectorise. The common canvas widths are compiled
+    //with their stride as a constant.
+    uint32_t *offsets = out + i * m_bins;
+    switch (m_width) {
+      case 1024: expandSpoke<1024 * 4>(offsets, x, y, xSign, ySign, m_reach, base); break;
+      case 2048: expandSpoke<2048 * 4>(offsets, x, y, xSign, ySign, m_reach, base); break;
+      default: expandSpoke(offsets, x, y, xSign, ySign, m_reach, base, stride); break;
+    }
+  }
+}
+
+ScanTable::ScanTable(uint32_t const *offsets, uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins) noexcept
+  : m_origin(origin)
+  , m_width(c_width)
+  , m_height(c_height)
+  , m_spokes(spokes)
+  , m_bins(bins)
+  , m_reach(bins)
+  , m_pixelsPerBin(1.0f)
+  , m_valid(offsets != nullptr && spokes > 0 && bins > 0)
+  , m_offsets()
+  , m_external(offsets) {
+}
+
+bool ScanTable::valid() const noexcept {
+  return m_valid;
+}
+
+uint16_t ScanTable::origin() const noexcept {
+  return m_origin;
+}
+
+uint16_t ScanTable::width() const noexcept {
+  return m_width;
+}
+
+uint16_t ScanTable::height() const noexcept {
+  return m_height;
+}
+
+uint16_t ScanTable::spokes() const noexcept {
+  return m_spokes;
+}
+
+uint16_t ScanTable::bins() const noexcept {
+  return m_bins;
+}
+
+uint16_t ScanTable::reach() const noexcept {
+  return m_reach;
+}
+
+float ScanTable::pixelsPerBin() const noexcept {
+  return m_pixelsPerBin;
+}
+
+uint32_t ScanTable::canvasSize() const noexcept {
+  return uint32_t(m_width) * m_height * 4;
+}
+
+const uint32_t *ScanTable::spoke(uint32_t spoke) const noexcept {
+  return ((m_external != nullptr) ? m_external : m_offsets.data()) + spoke * m_bins;
+}
+
+InverseScanTable::InverseScanTable(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins, float pixelsPerBin) noexcept
+  : m_width(c_width)
+  , m_height(c_height)
+  , m_spokes(spokes)
+  , m_bins(bins)
+  , m_rowBegin(c_height, 0)
+  , m_rowEnd(c_height, 0)
+  , m_sources(uint32_t(c_width) * c_height, 0) {
+
+  //Pixels are in range when they round to a bin below bins, the same rounding as the forward table.
+  double const limit = (m_bins - 0.5) * pixelsPerBin;
+  for (uint32_t y = 0; y < m_height; y++) {
+    double const dy = double(origin) - y;
+    bool inside = false;
+    for (uint32_t x = 0; x < m_width; x++) {
+      double const dx = double(x) - origin;
+      double const distance = std::sqrt(dx * dx + dy * dy);
+      if (distance >= limit) {
+        if (inside) break;
+        continue;
+      }
+      if (!inside) {
+        m_rowBegin[y] = uint16_t(x);
+        inside = true;
+      }
+      m_rowEnd[y] = uint16_t(x + 1);
+
+      //Clockwise from north, as in the forward table.
+      double angle = std::atan2(dx, dy);
+      if (angle < 0) angle += 2 * M_PI;
+      uint32_t const spoke = uint32_t(std::lround(angle * m_spokes / (2 * M_PI))) % m_spokes;
+      uint32_t const bin = std::min<uint32_t>(uint32_t(std::lround(distance / pixelsPerBin)), m_bins - 1u);
+      m_sources[y * m_width + x] = spoke * m_bins + bin;
+    }
+  }
+}
+
+uint16_t InverseScanTable::width() const noexcept {
+  return m_width;
+}
+
+uint16_t InverseScanTable::height() const noexcept {
+  return m_height;
+}
+
+uint16_t InverseScanTable::spokes() const noexcept {
+  return m_spokes;
+}
+
+uint16_t InverseScanTable::bins() const noexcept {
+  return m_bins;
+}
+
+uint16_t InverseScanTable::rowBegin(uint32_t y) const noexcept {
+  return m_rowBegin[y];
+}
+
+uint16_t InverseScanTable::rowEnd(uint32_t y) const noexcept {
+  return m_rowEnd[y];
+}
+
+const uint32_t *InverseScanTable::row(uint32_t y) const noexcept {
+  return m_sources.data() + y * m_width;
+}
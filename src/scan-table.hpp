@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_TABLE
+#define SCAN_TABLE
+
+#include <cstdint>
+#include <vector>
+
+//Compact scan-conversion table. Holds the pixel displacement of every bin for the first octant of spokes (0 to 45
+//degrees, about 0.5 MB for 2048 x 512) and derives the other seven octants by swapping and mirroring. When the spoke
+//count is not a multiple of 8 every spoke is stored instead. Bins are pixelsPerBin pixels apart, one by default.
+class OctantTable {
+ public:
+  OctantTable(uint16_t spokes = 2048, uint16_t bins = 512, float pixelsPerBin = 1.0f) noexcept;
+
+  uint16_t spokes() const noexcept;
+  uint16_t bins() const noexcept;
+  float pixelsPerBin() const noexcept;
+
+  //Size of the stored displacements in bytes.
+  uint32_t size() const noexcept;
+
+  //Displacement of every bin of a spoke is dx[j] = xSign * x[j] to the right and dy[j] = ySign * y[j] upwards.
+  void symmetry(uint32_t spoke, int16_t const *&x, int16_t const *&y, int32_t &xSign, int32_t &ySign) const noexcept;
+
+  //Displacement of one bin, to the right and upwards.
+  void displacement(uint32_t spoke, uint32_t bin, int32_t &dx, int32_t &dy) const noexcept;
+
+ private:
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  float m_pixelsPerBin;
+  bool m_octant;
+  std::vector<int16_t> m_dx;
+  std::vector<int16_t> m_dy;
+};
+
+//Scan-conversion table. For every spoke and bin it holds the byte offset of the target pixel in a 4 byte per pixel
+//canvas. Every offset is checked against the canvas once, when the table is built, so the decoder does not have to.
+//At one pixel per bin the whole spoke must fit the canvas. A table scaled for a range ends at the last bin whose
+//circle fits, and the bins beyond it are not drawn. Canvases 1024 and 2048 pixels wide are
+//expanded with their row stride as a constant.
+class ScanTable {
+ public:
+  ScanTable(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes = 2048, uint16_t bins = 512) noexcept;
+
+  //Expands the compact table for the given canvas. With storage set, the offsets are written to the spokes * bins
+  //entries it points to instead of owned memory, and the storage must outlive the table.
+  ScanTable(OctantTable const &octant, uint16_t origin, uint16_t c_width, uint16_t c_height, uint32_t *storage = nullptr) noexcept;
+
+  //View of offsets built earlier, such as a table mapped from shared memory. The offsets must outlive the table.
+  ScanTable(uint32_t const *offsets, uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins) noexcept;
+
+  //Copies of a view share the viewed offsets.
+  ScanTable(ScanTable const &) = default;
+  ScanTable(ScanTable &&) = default;
+  ScanTable &operator=(ScanTable const &) = default;
+  ScanTable &operator=(ScanTable &&) = default;
+
+  //True if every pixel of the table lies within the canvas.
+  bool valid() const noexcept;
+
+  uint16_t origin() const noexcept;
+  uint16_t width() const noexcept;
+  uint16_t height() const noexcept;
+  uint16_t spokes() const noexcept;
+  uint16_t bins() const noexcept;
+  //Bins drawn from the origin out, at most bins(). Offsets past it are not set.
+  uint16_t reach() const noexcept;
+  float pixelsPerBin() const noexcept;
+
+  //Size in bytes of the canvas the offsets point into.
+  uint32_t canvasSize() const noexcept;
+
+  //Byte offsets for the bins of one spoke. spoke must be below spokes().
+  const uint32_t *spoke(uint32_t spoke) const noexcept;
+
+ private:
+  uint16_t m_origin;
+  uint16_t m_width;
+  uint16_t m_height;
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  uint16_t m_reach;
+  float m_pixelsPerBin;
+  bool m_valid;
+  std::vector<uint32_t> m_offsets;
+  uint32_t const *m_external;
+};
+
+//Inverse scan-conversion table. For every pixel of the canvas within range it holds the polar source of the pixel,
+//as spoke * bins + bin, so that every pixel is filled exactly once. Inside the range circle the pixels of a row
+//are contiguous, so each row stores the span of pixels it covers. Bins are pixelsPerBin pixels apart.
+class InverseScanTable {
+ public:
+  InverseScanTable(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes = 2048, uint16_t bins = 512, float pixelsPerBin = 1.0f) noexcept;
+
+  uint16_t width() const noexcept;
+  uint16_t height() const noexcept;
+  uint16_t spokes() const noexcept;
+  uint16_t bins() const noexcept;
+
+  //First pixel and one past the last pixel covered in a row. Empty rows have begin == end.
+  uint16_t rowBegin(uint32_t y) const noexcept;
+  uint16_t rowEnd(uint32_t y) const noexcept;
+
+  //Polar sources for the pixels of a row, indexed by x.
+  const uint32_t *row(uint32_t y) const noexcept;
+
+ private:
+  uint16_t m_width;
+  uint16_t m_height;
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  std::vector<uint16_t> m_rowBegin;
+  std::vector<uint16_t> m_rowEnd;
+  std::vector<uint32_t> m_sources;
+};
+
+#endif
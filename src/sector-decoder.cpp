@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <utility>
+
+#include "sector-decoder.hpp"
+#include "spoke-kernel.hpp"
+
+SectorPartition::SectorPartition(ScanTable const &table, uint32_t sectors) noexcept
+  : m_spokes(table.spokes())
+  , m_sectors((sectors == 0) ? 1 : sectors)
+  , m_runBegin(table.spokes() + 1u, 0)
+  , m_runs()
+  , m_sharedPixels(0) {
+
+  //Owner of every pixel, set in spoke order so the highest spoke covering a pixel decides. Spokes are assumed to
+  //fit the canvas, as checked by the table.
+  uint32_t const pixels = table.canvasSize() / 4;
+  uint16_t const unowned = 0xffff;
+  std::vector<uint16_t> owner(pixels, unowned);
+  std::vector<uint8_t> shared(pixels, 0);
+  for (uint32_t spoke = 0; spoke < m_spokes && table.valid(); spoke++) {
+    uint16_t const s = uint16_t(sector(spoke));
+    uint32_t const *offsets = table.spoke(spoke);
+    for (uint32_t bin = 0; bin < table.reach(); bin++) {
+      uint32_t const pixel = offsets[bin] / 4;
+      if (owner[pixel] != unowned && owner[pixel] != s) shared[pixel] = 1;
+      owner[pixel] = s;
+    }
+  }
+  for (uint32_t pixel = 0; pixel < pixels; pixel++) m_sharedPixels += shared[pixel];
+
+  for (uint32_t spoke = 0; spoke < m_spokes; spoke++) {
+    m_runBegin[spoke] = uint32_t(m_runs.size() / 2);
+    if (!table.valid()) continue;
+    uint16_t const s = uint16_t(sector(spoke));
+    uint32_t const *offsets = table.spoke(spoke);
+    bool inRun = false;
+    for (uint32_t bin = 0; bin < table.reach(); bin++) {
+      bool const owned = owner[offsets[bin] / 4] == s;
+      if (owned && !inRun) m_runs.push_back(uint16_t(bin));
+      if (!owned && inRun) m_runs.push_back(uint16_t(bin));
+      inRun = owned;
+    }
+    if (inRun) m_runs.push_back(table.reach());
+  }
+  m_runBegin[m_spokes] = uint32_t(m_runs.size() / 2);
+}
+
+uint32_t SectorPartition::sectors() const noexcept {
+  return m_sectors;
+}
+
+uint32_t SectorPartition::sector(uint32_t spoke) const noexcept {
+  return uint32_t(uint64_t(spoke) * m_sectors / m_spokes);
+}
+
+uint32_t SectorPartition::runCount(uint32_t spoke) const noexcept {
+  return m_runBegin[spoke + 1] - m_runBegin[spoke];
+}
+
+uint16_t const *SectorPartition::runs(uint32_t spoke) const noexcept {
+  return m_runs.data() + m_runBegin[spoke] * 2;
+}
+
+uint32_t SectorPartition::sharedPixels() const noexcept {
+  return m_sharedPixels;
+}
+
+void scatterOwned(char *canvas, ScanTable const &table, SectorPartition const &partition, uint32_t spoke, uint8_t const *row, Palette const &palette) noexcept {
+  ScatterKernel const kernel = scatterKernel();
+  uint32_t const *offsets = table.spoke(spoke);
+  uint16_t const *runs = partition.runs(spoke);
+  for (uint32_t i = 0; i < partition.runCount(spoke); i++) {
+    uint32_t const begin = runs[2 * i];
+    uint32_t const end = runs[2 * i + 1];
+    kernel(canvas, offsets + begin, row + begin, end - begin, palette.argb);
+  }
+}
+
+SectorDecoder::SectorDecoder(ScanTable const &table, std::shared_ptr<Palette const> palette, PolarBuffer &polar, char *canvas, uint32_t workers, uint32_t queueSlots) noexcept
+  : m_table(table)
+  , m_palette(std::move(palette))
+  , m_polar(polar)
+  , m_canvas(canvas)
+  , m_partition(table, (workers == 0) ? ((std::thread::hardware_concurrency() > 0) ? std::thread::hardware_concurrency() : 1) : workers) {
+  for (uint32_t i = 0; i < m_partition.sectors(); i++) {
+    m_workers.emplace_back(new Worker);
+    //Slots take the whole spoke, since the sample selection depends on its full length.
+    m_workers.back()->queue.reset(new SpokeQueue{queueSlots, (table.bins() * 4u > 2048u) ? table.bins() * 4u : 2048u});
+  }
+  for (auto &worker : m_workers) {
+    Worker *w = worker.get();
+    w->thread = std::thread([this, w]() { work(*w); });
+  }
+}
+
+SectorDecoder::~SectorDecoder() noexcept {
+  m_running = false;
+  for (auto &worker : m_workers) worker->thread.join();
+}
+
+uint32_t SectorDecoder::workers() const noexcept {
+  return uint32_t(m_workers.size());
+}
+
+SectorPartition const &SectorDecoder::partition() const noexcept {
+  return m_partition;
+}
+
+int SectorDecoder::push(SpokeView const &spoke) noexcept {
+  int const index = spokeIndex(spoke, m_polar.spokes(), false);
+  if (index < 0) return index;
+
+  Worker &worker = *m_workers[m_partition.sector(uint32_t(index))];
+  if (!worker.queue->push(spoke)) return (-14);
+  return index;
+}
+
+void SectorDecoder::drain() noexcept {
+  for (auto &worker : m_workers) {
+    uint64_t const pushed = worker->queue->stats().pushed;
+    while (worker->done.load(std::memory_order_acquire) < pushed) std::this_thread::yield();
+  }
+}
+
+SpokeQueueStats SectorDecoder::stats(uint32_t worker) const noexcept {
+  return m_workers[worker]->queue->stats();
+}
+
+void SectorDecoder::work(Worker &worker) noexcept {
+  uint32_t idle = 0;
+  while (m_running) {
+    SpokeView spoke;
+    if (!worker.queue->front(spoke)) {
+      //Spin briefly before sleeping, so a busy radar does not pay for a wake up per spoke.
+      if (++idle < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      continue;
+    }
+    idle = 0;
+
+    //The queue holds full spokes with a valid azimuth, so only the row has to be filled and scattered.
+    uint32_t const index = uint32_t(spokeIndex(spoke, m_polar.spokes(), false));
+    uint8_t *row = m_polar.row(index);
+    writeRow(spoke, row, m_polar.bins());
+    std::shared_ptr<Palette const> const palette = std::atomic_load(&m_palette);
+    scatterOwned(m_canvas, m_table, m_partition, index, row, *palette);
+    worker.queue->pop();
+    worker.done.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void SectorDecoder::setPalette(std::shared_ptr<Palette const> palette) noexcept {
+  std::atomic_store(&m_palette, std::move(palette));
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SECTOR_DECODER
+#define SECTOR_DECODER
+
+#include "palette.hpp"
+#include "polar-buffer.hpp"
+#include "radar-decoder.hpp"
+#include "scan-table.hpp"
+#include "spoke-queue.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//Splits the spokes of a scan table into contiguous sectors and gives every pixel of the canvas to exactly one of
+//them. Spokes of different sectors only meet near the origin and along the seams; such a pixel belongs to the sector
+//of the highest spoke that covers it, as in a full render in spoke order. For every spoke the partition keeps the
+//runs of bins whose pixels its own sector owns, so sectors can be written in parallel without sharing a pixel.
+class SectorPartition {
+ public:
+  SectorPartition(ScanTable const &table, uint32_t sectors) noexcept;
+
+  uint32_t sectors() const noexcept;
+
+  //Sector a spoke belongs to.
+  uint32_t sector(uint32_t spoke) const noexcept;
+
+  //Owned runs of a spoke as runCount(spoke) pairs of first bin and one past the last bin.
+  uint32_t runCount(uint32_t spoke) const noexcept;
+  uint16_t const *runs(uint32_t spoke) const noexcept;
+
+  //Pixels covered by more than one sector.
+  uint32_t sharedPixels() const noexcept;
+
+ private:
+  uint32_t m_spokes;
+  uint32_t m_sectors;
+  std::vector<uint32_t> m_runBegin;
+  std::vector<uint16_t> m_runs;
+  uint32_t m_sharedPixels;
+};
+
+//Scatters the owned runs of one spoke from its polar row into the canvas.
+void scatterOwned(char *canvas, ScanTable const &table, SectorPartition const &partition, uint32_t spoke, uint8_t const *row, Palette const &palette) noexcept;
+
+//Decode workers that each own a sector of spokes. Spokes are routed to the worker owning their azimuth through a
+//queue per worker; the worker writes the polar row and scatters the owned pixels straight into the canvas, without
+//locks. The polar rows are written but not marked dirty, since the canvas is already up to date.
+//push() and drain() must be called from a single thread.
+class SectorDecoder {
+ private:
+  SectorDecoder(const SectorDecoder &) = delete;
+  SectorDecoder(SectorDecoder &&)      = delete;
+  SectorDecoder &operator=(const SectorDecoder &) = delete;
+  SectorDecoder &operator=(SectorDecoder &&) = delete;
+
+ public:
+  //The table must match the polar buffer geometry and fit the canvas. workers of 0 uses one per core.
+  SectorDecoder(ScanTable const &table, std::shared_ptr<Palette const> palette, PolarBuffer &polar, char *canvas, uint32_t workers, uint32_t queueSlots = 256) noexcept;
+  ~SectorDecoder() noexcept;
+
+  uint32_t workers() const noexcept;
+  SectorPartition const &partition() const noexcept;
+
+  //Hands a spoke to the worker owning it. Returns the spoke index, a negative decoder code for a bad spoke, or -14
+  //if the worker's queue is full.
+  int push(SpokeView const &spoke) noexcept;
+
+  //Returns once every spoke pushed so far is in the canvas.
+  void drain() noexcept;
+
+  //Counters of one worker's queue.
+  SpokeQueueStats stats(uint32_t worker) const noexcept;
+
+  //Palette for the spokes decoded from now on. A spoke being decoded finishes with the palette it started with.
+  void setPalette(std::shared_ptr<Palette const> palette) noexcept;
+
+ private:
+  struct Worker {
+    std::unique_ptr<SpokeQueue> queue{};
+    std::atomic<uint64_t> done{0};
+    std::thread thread{};
+  };
+
+  void work(Worker &worker) noexcept;
+
+  ScanTable const &m_table;
+  //Only read and written through std::atomic_load and std::atomic_store.
+  std::shared_ptr<Palette const> m_palette;
+  PolarBuffer &m_polar;
+  char *m_canvas;
+  SectorPartition m_partition;
+  std::atomic<bool> m_running{true};
+  std::vector<std::unique_ptr<Worker>> m_workers{};
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "shared-scan-table.hpp"
+
+#include <chrono>
+#include <new>
+#include <thread>
+
+static uint32_t const SHARED_SCAN_TABLE_MAGIC = 0x52534354;
+static uint32_t const SHARED_SCAN_TABLE_HEADER = 64;
+//Building a table takes well under a second, so a segment not ready after this long is left to its creator.
+static uint32_t const SHARED_SCAN_TABLE_WAIT_MS = 2000;
+
+static_assert(sizeof(SharedScanTableHeader) <= SHARED_SCAN_TABLE_HEADER, "header must fit before the offsets");
+
+static std::string sharedScanTableName(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins) {
+  return "/radar-scan-table-" + std::to_string(origin) + "-" + std::to_string(c_width) + "x" + std::to_string(c_height)
+    + "-" + std::to_string(spokes) + "x" + std::to_string(bins);
+}
+
+SharedScanTable::SharedScanTable(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes, uint16_t bins) noexcept
+  : m_origin(origin)
+  , m_width(c_width)
+  , m_height(c_height)
+  , m_spokes(spokes)
+  , m_bins(bins)
+  , m_name(sharedScanTableName(origin, c_width, c_height, spokes, bins))
+  , m_shm()
+  , m_attached(false)
+  , m_table(nullptr, origin, c_width, c_height, spokes, bins) {
+
+  //Creating the segment again while another process builds it would replace that segment, leaving the two processes
+  //with separate tables, so a segment that is not ready yet is waited for. One still not ready after that was left
+  //by a creator that died while building, and is built again. 
+  int found = attach();
+  for (uint32_t waited = 0; found == -1 && waited < SHARED_SCAN_TABLE_WAIT_MS; waited += 10) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    found = attach();
+  }
+  if (found > 0) {
+    m_attached = true;
+  } else if (found == -2 || !create()) {
+    m_shm.reset();
+    m_table = ScanTable{origin, c_width, c_height, spokes, bins};
+  }
+}
+
+int SharedScanTable::attach() noexcept {
+  m_shm.reset(new cluon::SharedMemory{m_name});
+  uint32_t const bytes = SHARED_SCAN_TABLE_HEADER + uint32_t(m_spokes) * m_bins * 4;
+  if (!m_shm->valid() || m_shm->size() < bytes) {
+    return 0;
+  }
+
+  //The creator holds the lock while building, but the segment exists shortly before it takes the lock; the header
+  //is still zero then, or not yet marked ready.
+  m_shm->lock();
+  SharedScanTableHeader const *header = reinterpret_cast<SharedScanTableHeader const*>(m_shm->data());
+  bool const ready = header->ready.load(std::memory_order_acquire) == 1;
+  uint32_t const magic = header->magic;
+  bool const match = header->origin == m_origin && header->width == m_width && header->height == m_height
+    && header->spokes == m_spokes && header->bins == m_bins;
+  m_shm->unlock();
+  if (magic == 0 || (magic == SHARED_SCAN_TABLE_MAGIC && !ready)) {
+    return (-1);
+  }
+  if (magic != SHARED_SCAN_TABLE_MAGIC || !match) {
+    return 0;
+  }
+
+  //Every renderer writes at these offsets without checking them again, and any process with access to the segment
+  //can write it, so the whole table is checked against the canvas once here.
+  uint32_t const *offsets = reinterpret_cast<uint32_t const*>(m_shm->data() + SHARED_SCAN_TABLE_HEADER);
+  uint32_t const last = uint32_t(m_width) * m_height * 4 - 4;
+  uint32_t const count = uint32_t(m_spokes) * m_bins;
+  for (uint32_t i = 0; i < count; i++) {
+    if (offsets[i] % 4 != 0 || offsets[i] > last) {
+      return (-2);
+    }
+  }
+  m_table = ScanTable{offsets, m_origin, m_width, m_height, m_spokes, m_bins};
+  return 1;
+}
+
+bool SharedScanTable::create() noexcept {
+  uint32_t const bytes = SHARED_SCAN_TABLE_HEADER + uint32_t(m_spokes) * m_bins * 4;
+  m_shm.reset(new cluon::SharedMemory{m_name, bytes});
+  if (!m_shm->valid()) {
+    return false;
+  }
+
+  m_shm->lock();
+  SharedScanTableHeader *header = new (m_shm->data()) SharedScanTableHeader;
+  header->magic = SHARED_SCAN_TABLE_MAGIC;
+  header->origin = m_origin;
+  header->width = m_width;
+  header->height = m_height;
+  header->spokes = m_spokes;
+  header->bins = m_bins;
+  header->reserved = 0;
+  header->ready.store(0, std::memory_order_relaxed);
+
+  uint32_t *offsets = reinterpret_cast<uint32_t*>(m_shm->data() + SHARED_SCAN_TABLE_HEADER);
+  m_table = ScanTable{OctantTable{m_spokes, m_bins}, m_origin, m_width, m_height, offsets};
+  header->ready.store(m_table.valid() ? 1 : 0, std::memory_order_release);
+  m_shm->unlock();
+  return m_table.valid();
+}
+
+ScanTable const &SharedScanTable::table() const noexcept {
+  return m_table;
+}
+
+bool SharedScanTable::attached() const noexcept {
+  return m_attached;
+}
+
+bool SharedScanTable::shared() const noexcept {
+  return m_shm != nullptr;
+}
+
+std::string const &SharedScanTable::name() const noexcept {
+  return m_name;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHARED_SCAN_TABLE
+#define SHARED_SCAN_TABLE
+
+#include "cluon-complete.hpp"
+#include "scan-table.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//Layout at the start of a shared scan table segment, followed by the offsets from byte 64.
+struct SharedScanTableHeader {
+  uint32_t magic;
+  uint16_t origin;
+  uint16_t width;
+  uint16_t height;
+  uint16_t spokes;
+  uint16_t bins;
+  uint16_t reserved;
+  std::atomic<uint32_t> ready;
+};
+
+//Scan table shared by every process on the host that uses the same geometry. The first process builds the offsets
+//into a named cluon::SharedMemory segment; later processes attach to it and map the finished table instead of
+//building their own. A process that finds the segment still being built waits for it, and builds it again if it is
+//never finished. A segment whose offsets fall outside the canvas is not used, and neither is a segment that cannot be
+//created; the table is then built privately.
+//The segment belongs to the process that built it and is removed by its destructor. Processes already attached keep
+//their mapping, but processes started after that build a new segment, so the table is only shared by the processes
+//started while its creator runs.
+class SharedScanTable {
+ public:
+  SharedScanTable(uint16_t origin, uint16_t c_width, uint16_t c_height, uint16_t spokes = 2048, uint16_t bins = 512) noexcept;
+
+  ScanTable const &table() const noexcept;
+
+  //True if the table was mapped from a segment built by another instance.
+  bool attached() const noexcept;
+
+  //True if the table lives in shared memory, either built or attached.
+  bool shared() const noexcept;
+
+  //Segment name derived from the geometry.
+  std::string const &name() const noexcept;
+
+ private:
+  SharedScanTable(SharedScanTable const &) = delete;
+  SharedScanTable &operator=(SharedScanTable const &) = delete;
+
+  //1 if the finished table was mapped, 0 if there is no segment of this geometry, -1 if one is still being built and
+  //-2 if its offsets do not fit the canvas.
+  int attach() noexcept;
+  bool create() noexcept;
+
+  uint16_t m_origin;
+  uint16_t m_width;
+  uint16_t m_height;
+  uint16_t m_spokes;
+  uint16_t m_bins;
+  std::string m_name;
+  std::unique_ptr<cluon::SharedMemory> m_shm;
+  bool m_attached;
+  ScanTable m_table;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "spoke-kernel.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPOKE_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+void scatterScalar(char *canvas, uint32_t const *offsets, uint8_t const *strengths, uint32_t count, uint32_t const *palette) noexcept {
+  for (uint32_t i = 0; i < count; i++) {
+    std::memcpy(canvas + offsets[i], &palette[strengths[i]], 4);
+  }
+}
+
+#ifdef SPOKE_KERNEL_X86
+
+//The vector kernels are compiled for their instruction set with target attributes. The rest of the build keeps
+//the baseline flags, and the dispatcher only selects a kernel when the CPU reports support for it.
+
+//Stores 4 pixel words held in a vector at the 4 offsets held in another.
+__attribute__((target("sse4.1")))
+static inline void storeLanes(char *canvas, __m128i offsets, __m128i words) noexcept {
+  uint32_t w;
+  w = uint32_t(_mm_extract_epi32(words, 0)); std::memcpy(canvas + uint32_t(_mm_extract_epi32(offsets, 0)), &w, 4);
+  w = uint32_t(_mm_extract_epi32(words, 1)); std::memcpy(canvas + uint32_t(_mm_extract_epi32(offsets, 1)), &w, 4);
+  w = uint32_t(_mm_extract_epi32(words, 2)); std::memcpy(canvas + uint32_t(_mm_extract_epi32(offsets, 2)), &w, 4);
+  w = uint32_t(_mm_extract_epi32(words, 3)); std::memcpy(canvas + uint32_t(_mm_extract_epi32(offsets, 3)), &w, 4);
+}
+
+//Looks up 4 strengths, widened to 32 bit lanes, in the palette. SSE4.1 has no gather, so lanes are inserted.
+__attribute__((target("sse4.1")))
+static inline __m128i lookupLanes(__m128i index, uint32_t const *palette) noexcept {
+  __m128i words = _mm_cvtsi32_si128(int(palette[_mm_extract_epi32(index, 0)]));
+  words = _mm_insert_epi32(words, int(palette[_mm_extract_epi32(index, 1)]), 1);
+  words = _mm_insert_epi32(words, int(palette[_mm_extract_epi32(index, 2)]), 2);
+  words = _mm_insert_epi32(words, int(palette[_mm_extract_epi32(index, 3)]), 3);
+  return words;
+}
+
+//16 strengths per iteration.
+__attribute__((target("sse4.1")))
+static void scatterSse41(char *canvas, uint32_t const *offsets, uint8_t const *strengths, uint32_t count, uint32_t const *palette) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(strengths + i));
+    __m128i const *lanes = reinterpret_cast<__m128i const*>(offsets + i);
+    storeLanes(canvas, _mm_loadu_si128(lanes + 0), lookupLanes(_mm_cvtepu8_epi32(bytes), palette));
+    storeLanes(canvas, _mm_loadu_si128(lanes + 1), lookupLanes(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)), palette));
+    storeLanes(canvas, _mm_loadu_si128(lanes + 2), lookupLanes(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), palette));
+    storeLanes(canvas, _mm_loadu_si128(lanes + 3), lookupLanes(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12)), palette));
+  }
+  scatterScalar(canvas, offsets + i, strengths + i, count - i, palette);
+}
+
+//32 strengths per iteration. The palette is read with gathers, 8 words each; the stores stay scalar since AVX2
+//has no scatter.
+__attribute__((target("avx2")))
+static void scatterAvx2(char *canvas, uint32_t const *offsets, uint8_t const *strengths, uint32_t count, uint32_t const *palette) noexcept {
+  int const *table = reinterpret_cast<int const*>(palette);
+  uint32_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    alignas(32) uint32_t words[32];
+    for (uint32_t g = 0; g < 32; g += 8) {
+      __m256i const index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(strengths + i + g)));
+      _mm256_store_si256(reinterpret_cast<__m256i*>(words + g), _mm256_i32gather_epi32(table, index, 4));
+    }
+    for (uint32_t j = 0; j < 32; j++) {
+      std::memcpy(canvas + offsets[i + j], &words[j], 4);
+    }
+  }
+  scatterScalar(canvas, offsets + i, strengths + i, count - i, palette);
+}
+
+#endif
+
+KernelLevel detectKernelLevel() noexcept {
+#ifdef SPOKE_KERNEL_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return KernelLevel::Avx2;
+  if (__builtin_cpu_supports("sse4.1")) return KernelLevel::Sse41;
+#endif
+  return KernelLevel::Scalar;
+}
+
+ScatterKernel scatterKernel(KernelLevel level) noexcept {
+  KernelLevel const supported = detectKernelLevel();
+  if (int(level) > int(supported)) level = supported;
+#ifdef SPOKE_KERNEL_X86
+  if (level == KernelLevel::Avx2) return scatterAvx2;
+  if (level == KernelLevel::Sse41) return scatterSse41;
+#endif
+  return scatterScalar;
+}
+
+ScatterKernel scatterKernel() noexcept {
+  static ScatterKernel const kernel = scatterKernel(detectKernelLevel());
+  return kernel;
+}
+
+char const *kernelName(KernelLevel level) noexcept {
+  switch (level) {
+    case KernelLevel::Avx2: return "avx2";
+    case KernelLevel::Sse41: return "sse4.1";
+    default: return "scalar";
+  }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPOKE_KERNEL
+#define SPOKE_KERNEL
+
+#include <cstdint>
+
+//Instruction set used by a scatter kernel.
+enum class KernelLevel { Scalar = 0, Sse41 = 1, Avx2 = 2 };
+
+//Scatter kernel. Converts count strengths to pixels through the 256 entry palette and stores each pixel at
+//canvas + offsets[i]. The offsets must already be checked against the canvas (see ScanTable).
+typedef void (*ScatterKernel)(char *canvas, uint32_t const *offsets, uint8_t const *strengths, uint32_t count, uint32_t const *palette);
+
+//Reference implementation. The vector kernels must produce the same canvas bit for bit.
+void scatterScalar(char *canvas, uint32_t const *offsets, uint8_t const *strengths, uint32_t count, uint32_t const *palette) noexcept;
+
+//Highest kernel level supported by this CPU.
+KernelLevel detectKernelLevel() noexcept;
+
+//Kernel for the given level, or for the highest supported level below it.
+ScatterKernel scatterKernel(KernelLevel level) noexcept;
+
+//Kernel for the highest level supported by this CPU, selected once at first use.
+ScatterKernel scatterKernel() noexcept;
+
+char const *kernelName(KernelLevel level) noexcept;
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+
+#include "spoke-queue.hpp"
+
+static uint32_t roundUpPowerOfTwo(uint32_t value) noexcept {
+  uint32_t power = 1;
+  while (power < value) power <<= 1;
+  return power;
+}
+
+SpokeQueue::SpokeQueue(uint32_t capacity, uint32_t maxLength) noexcept
+  : m_mask(roundUpPowerOfTwo(capacity == 0 ? 1 : capacity) - 1)
+  , m_maxLength(maxLength)
+  , m_slots(m_mask + 1, Slot{0, 0, 0})
+  , m_data(size_t(m_mask + 1) * maxLength, 0) {
+}
+
+uint32_t SpokeQueue::capacity() const noexcept {
+  return m_mask + 1;
+}
+
+uint32_t SpokeQueue::maxLength() const noexcept {
+  return m_maxLength;
+}
+
+bool SpokeQueue::push(SpokeView const &spoke) noexcept {
+  uint32_t const tail = m_tail.load(std::memory_order_relaxed);
+  uint32_t const head = m_head.load(std::memory_order_acquire);
+  uint32_t const depth = tail - head;
+  if (depth > m_mask || spoke.length > m_maxLength) {
+    m_drops.store(m_drops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  uint32_t const index = tail & m_mask;
+  Slot &slot = m_slots[index];
+  slot.length = spoke.length;
+  slot.azimuth = spoke.azimuth;
+  slot.range = spoke.range;
+  if (spoke.length > 0) std::memcpy(m_data.data() + size_t(index) * m_maxLength, spoke.data, spoke.length);
+  m_tail.store(tail + 1, std::memory_order_release);
+
+  //Only the producer writes the counters, so plain loads and stores are enough.
+  m_pushed.store(m_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (depth + 1 > m_highWater.load(std::memory_order_relaxed)) m_highWater.store(depth + 1, std::memory_order_relaxed);
+  return true;
+}
+
+bool SpokeQueue::front(SpokeView &spoke) const noexcept {
+  return peek(0, spoke);
+}
+
+bool SpokeQueue::peek(uint32_t offset, SpokeView &spoke) const noexcept {
+  uint32_t const head = m_head.load(std::memory_order_relaxed);
+  if (m_tail.load(std::memory_order_acquire) - head <= offset) {
+    return false;
+  }
+  uint32_t const index = (head + offset) & m_mask;
+  Slot const &slot = m_slots[index];
+  spoke.data = m_data.data() + size_t(index) * m_maxLength;
+  spoke.length = slot.length;
+  spoke.azimuth = slot.azimuth;
+  spoke.range = slot.range;
+  return true;
+}
+
+void SpokeQueue::pop() noexcept {
+  m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+SpokeQueueStats SpokeQueue::stats() const noexcept {
+  SpokeQueueStats stats;
+  stats.depth = m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  stats.highWater = m_highWater.load(std::memory_order_relaxed);
+  stats.pushed = m_pushed.load(std::memory_order_relaxed);
+  stats.drops = m_drops.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPOKE_QUEUE
+#define SPOKE_QUEUE
+
+#include "radar-decoder.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+//Queue counters. depth is the number of spokes waiting, highWater the largest depth seen, drops the spokes rejected
+//because the queue was full or the spoke did not fit a slot.
+struct SpokeQueueStats {
+  uint32_t depth{0};
+  uint32_t highWater{0};
+  uint64_t pushed{0};
+  uint64_t drops{0};
+};
+
+//Bounded single producer, single consumer queue of spokes. Every slot is allocated up front with room for
+//maxLength bytes, so neither side allocates or locks. The receive thread pushes copies of incoming spokes and the
+//decode thread reads them in place.
+class SpokeQueue {
+ private:
+  SpokeQueue(const SpokeQueue &) = delete;
+  SpokeQueue(SpokeQueue &&)      = delete;
+  SpokeQueue &operator=(const SpokeQueue &) = delete;
+  SpokeQueue &operator=(SpokeQueue &&) = delete;
+
+ public:
+  //capacity is rounded up to a power of two.
+  SpokeQueue(uint32_t capacity = 1024, uint32_t maxLength = 2048) noexcept;
+
+  uint32_t capacity() const noexcept;
+  uint32_t maxLength() const noexcept;
+
+  //Producer side. Copies the spoke into the next free slot. Returns false and counts a drop if the queue is full
+  //or the spoke is longer than maxLength.
+  bool push(SpokeView const &spoke) noexcept;
+
+  //Consumer side. Views the oldest spoke, valid until pop(). Returns false if the queue is empty.
+  bool front(SpokeView &spoke) const noexcept;
+  void pop() noexcept;
+
+  //Consumer side. Views the spoke offset places behind the oldest, valid until it is popped. Returns false if fewer
+  //spokes are waiting.
+  bool peek(uint32_t offset, SpokeView &spoke) const noexcept;
+
+  //Safe to call from any thread.
+  SpokeQueueStats stats() const noexcept;
+
+ private:
+  struct Slot {
+    uint32_t length;
+    float azimuth;
+    float range;
+  };
+
+  uint32_t m_mask;
+  uint32_t m_maxLength;
+  std::vector<Slot> m_slots;
+  std::vector<uint8_t> m_data;
+
+  //Producer and consumer indices a cache line apart, padded rather than aligned so the queue can be allocated
+  //with plain new. Both count up and wrap at 2^32.
+  char m_pad0[64]{};
+  std::atomic<uint32_t> m_tail{0};
+  char m_pad1[64]{};
+  std::atomic<uint32_t> m_head{0};
+  char m_pad2[64]{};
+  std::atomic<uint32_t> m_highWater{0};
+  std::atomic<uint64_t> m_pushed{0};
+  std::atomic<uint64_t> m_drops{0};
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include "spoke-throttle.hpp"
+
+bool parseOverload(std::string const &name, Overload &overload) noexcept {
+  if (name == "off") overload = Overload::Off;
+  else if (name == "drop-oldest") overload = Overload::DropOldest;
+  else if (name == "latest") overload = Overload::LatestPerAzimuth;
+  else if (name == "decimate") overload = Overload::Decimate;
+  else if (name == "auto") overload = Overload::Auto;
+  else return false;
+  return true;
+}
+
+char const *overloadName(Overload overload) noexcept {
+  switch (overload) {
+    case Overload::DropOldest: return "drop-oldest";
+    case Overload::LatestPerAzimuth: return "latest";
+    case Overload::Decimate: return "decimate";
+    case Overload::Auto: return "auto";
+    default: return "off";
+  }
+}
+
+SpokeThrottle::SpokeThrottle(Overload policy, uint16_t spokes) noexcept
+  : m_policy(policy)
+  , m_spokes(spokes)
+  , m_newest(spokes, 0) {
+}
+
+Overload SpokeThrottle::policy() const noexcept {
+  return m_policy;
+}
+
+OverloadStats const &SpokeThrottle::stats() const noexcept {
+  return m_stats;
+}
+
+Overload SpokeThrottle::mode(uint32_t depth, uint32_t capacity) noexcept {
+  if (m_policy != Overload::Auto) return m_policy;
+  //LatestPerAzimuth needs more than a sweep waiting, which its level never holds below half the queue when the queue
+  //is two sweeps or shorter, as with the default 1024 slots and 2048 spokes. Decimate takes that level then.
+  static Overload const levels[] = {Overload::Off, Overload::LatestPerAzimuth, Overload::Decimate, Overload::DropOldest};
+  static Overload const shortLevels[] = {Overload::Off, Overload::Decimate, Overload::Decimate, Overload::DropOldest};
+  Overload const *modes = (capacity / 2 > uint32_t(m_spokes) + 1) ? levels : shortLevels;
+  Overload const before = modes[m_level];
+  while (m_level < 3 && depth >= uint64_t(capacity) * (m_level + 1) / 4) m_level++;
+  while (m_level > 0 && depth < uint64_t(capacity) * m_level / 8) m_level--;
+  if (modes[m_level] != before) m_stats.modeChanges++;
+  return modes[m_level];
+}
+
+bool SpokeThrottle::superseded(SpokeQueue const &queue, SpokeView const &front, uint32_t depth) noexcept {
+  //Each waiting spoke is looked at once, recording the newest per azimuth. Entries are sequence numbers plus one,
+  //so 0 is never newer than a waiting spoke.
+  SpokeView waiting;
+  for (uint64_t sequence = std::max(m_scanned, m_popped); sequence < m_popped + depth; sequence++) {
+    if (!queue.peek(uint32_t(sequence - m_popped), waiting)) break;
+    int const index = spokeIndex(waiting, m_spokes, false);
+    if (index >= 0) m_newest[uint32_t(index)] = sequence + 1;
+    m_scanned = sequence + 1;
+  }
+  int const index = spokeIndex(front, m_spokes, false);
+  return index >= 0 && m_newest[uint32_t(index)] > m_popped + 1;
+}
+
+bool SpokeThrottle::next(SpokeQueue &queue, SpokeView &spoke) noexcept {
+  SpokeView front;
+  while (queue.front(front)) {
+    uint32_t const depth = queue.stats().depth;
+    uint32_t const capacity = queue.capacity();
+    Overload const active = mode(depth, capacity);
+    m_stats.active = active;
+
+    uint32_t const keep = std::max(1u, capacity / 4);
+    if (active == Overload::DropOldest && depth > capacity / 2 && depth > keep) {
+      for (uint32_t i = keep; i < depth; i++) queue.pop();
+      m_popped += depth - keep;
+      m_stats.droppedOldest += depth - keep;
+      continue;
+    }
+    if (active == Overload::LatestPerAzimuth && superseded(queue, front, depth)) {
+      queue.pop();
+      m_popped++;
+      m_stats.coalesced++;
+      continue;
+    }
+    if (active == Overload::Decimate && depth >= capacity / 4) {
+      bool const skip = m_skipNext;
+      m_skipNext = !m_skipNext;
+      if (skip) {
+        queue.pop();
+        m_popped++;
+        m_stats.decimated++;
+        continue;
+      }
+    } else {
+      m_skipNext = false;
+    }
+
+    //Counted as popped here, as the caller pops it after decoding.
+    spoke = front;
+    m_popped++;
+    m_stats.decoded++;
+    return true;
+  }
+  return false;
+}
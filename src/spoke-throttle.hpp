@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPOKE_THROTTLE
+#define SPOKE_THROTTLE
+
+#include "radar-decoder.hpp"
+#include "spoke-queue.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//What the decode thread gives up when it falls behind the receive thread.
+//DropOldest skips the oldest waiting spokes once half the queue is waiting, down to a quarter, so the newest data is
+//drawn after one gap. LatestPerAzimuth skips a spoke when a newer one of the same azimuth is already waiting, which
+//only happens more than a sweep behind. Decimate skips every other spoke received while a quarter of the queue is
+//waiting. Auto steps from Off to LatestPerAzimuth, Decimate and DropOldest as the queue fills past a quarter, a
+//half and three quarters, and back as it drains below half of those. With a queue of two sweeps or less, where
+//LatestPerAzimuth would skip nothing, auto decimates from a quarter instead.
+enum class Overload : uint8_t {
+  Off,
+  DropOldest,
+  LatestPerAzimuth,
+  Decimate,
+  Auto
+};
+
+//Reads off, drop-oldest, latest, decimate or auto. False for anything else.
+bool parseOverload(std::string const &name, Overload &overload) noexcept;
+char const *overloadName(Overload overload) noexcept;
+
+//Spokes decoded and skipped by each mode, the mode applied to the last spoke and the number of times auto changed it.
+struct OverloadStats {
+  Overload active{Overload::Off};
+  uint64_t decoded{0};
+  uint64_t droppedOldest{0};
+  uint64_t coalesced{0};
+  uint64_t decimated{0};
+  uint32_t modeChanges{0};
+};
+
+//Consumer side of a spoke queue with an overload policy. The receive thread keeps pushing every spoke it can; the
+//spokes the policy skips are popped unread by the decode thread, so degrading costs less than decoding. Owned by the
+//decode thread.
+class SpokeThrottle {
+ public:
+  //spokes is the number of azimuths LatestPerAzimuth tells apart, as spokeIndex maps them.
+  SpokeThrottle(Overload policy, uint16_t spokes) noexcept;
+
+  Overload policy() const noexcept;
+
+  //Views the next spoke to decode, valid until queue.pop(), after popping the spokes the policy skips. Returns
+  //false if the queue is empty.
+  bool next(SpokeQueue &queue, SpokeView &spoke) noexcept;
+
+  OverloadStats const &stats() const noexcept;
+
+ private:
+  Overload mode(uint32_t depth, uint32_t capacity) noexcept;
+  bool superseded(SpokeQueue const &queue, SpokeView const &front, uint32_t depth) noexcept;
+
+  Overload m_policy;
+  uint16_t m_spokes;
+  OverloadStats m_stats{};
+  //Level of auto, 0 for Off up to 3 for DropOldest.
+  uint32_t m_level{0};
+  bool m_skipNext{false};
+  //Spokes popped so far, and sequence numbers, in that count, of the newest spoke seen per azimuth and of the first
+  //spoke not yet looked at.
+  uint64_t m_popped{0};
+  std::vector<uint64_t> m_newest;
+  uint64_t m_scanned{0};
+};
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include "sweep-assembler.hpp"
+
+SweepAssembler::SweepAssembler(uint16_t spokes, uint16_t window, uint8_t confirm, uint32_t maxGaps) noexcept
+  : m_spokes(spokes)
+  , m_window(std::max<uint16_t>(1, std::min<uint16_t>(window, uint16_t(spokes / 4))))
+  , m_confirm(std::max<uint8_t>(1, confirm))
+  , m_maxGaps(maxGaps)
+  , m_seen(spokes, 0) {
+  m_current.gaps.reserve(maxGaps);
+  m_last.gaps.reserve(maxGaps);
+  m_pendingSpokes.reserve(m_confirm);
+  m_pendingTimes.reserve(m_confirm);
+}
+
+uint32_t SweepAssembler::forward(uint32_t from, uint32_t to) const noexcept {
+  return (to + m_spokes - from) % m_spokes;
+}
+
+bool SweepAssembler::add(uint32_t spoke, int64_t timestamp) noexcept {
+  spoke %= m_spokes;
+  if (m_lastSpoke < 0) {
+    m_current.start = timestamp;
+    m_current.partial = true;
+    return step(spoke, timestamp);
+  }
+
+  uint32_t const ahead = forward(uint32_t(m_lastSpoke), spoke);
+  if (!m_pendingSpokes.empty()) {
+    uint32_t const fromPending = forward(m_pendingSpokes.back(), spoke);
+    if (fromPending > 0 && fromPending <= m_window) {
+      m_pendingSpokes.push_back(spoke);
+      m_pendingTimes.push_back(timestamp);
+      if (m_pendingSpokes.size() < m_confirm) return false;
+      //Confirmed. The jump and the spokes after it are taken in order.
+      bool completed = false;
+      for (size_t i = 0; i < m_pendingSpokes.size(); i++) {
+        completed = step(m_pendingSpokes[i], m_pendingTimes[i]) || completed;
+      }
+      m_pendingSpokes.clear();
+      m_pendingTimes.clear();
+      return completed;
+    }
+    if (fromPending == 0) {
+      m_current.duplicates++;
+      return false;
+    }
+    //The stream carries on from before the jump, or jumps elsewhere.
+    m_current.rejected += uint32_t(m_pendingSpokes.size());
+    m_pendingSpokes.clear();
+    m_pendingTimes.clear();
+  }
+
+  if (ahead == 0) {
+    m_current.duplicates++;
+    return false;
+  }
+  if (ahead <= m_window) return step(spoke, timestamp);
+  if (ahead >= uint32_t(m_spokes) - m_window) {
+    m_current.late++;
+    return false;
+  }
+  m_pendingSpokes.push_back(spoke);
+  m_pendingTimes.push_back(timestamp);
+  return false;
+}
+
+bool SweepAssembler::step(uint32_t spoke, int64_t timestamp) noexcept {
+  bool const wrapped = (m_lastSpoke >= 0) && (spoke < uint32_t(m_lastSpoke));
+  if (wrapped) {
+    //A jump past north leaves the new sweep without its first spokes.
+    bool const jumped = forward(uint32_t(m_lastSpoke), spoke) > m_window;
+    finish(timestamp);
+    m_current.partial = jumped;
+  }
+  m_lastSpoke = int32_t(spoke);
+  if (m_seen[spoke] != 0) {
+    m_current.duplicates++;
+  } else {
+    m_seen[spoke] = 1;
+    m_current.received++;
+  }
+  return wrapped;
+}
+
+void SweepAssembler::finish(int64_t timestamp) noexcept {
+  m_current.sweep = ++m_sweeps;
+  m_current.end = timestamp;
+  m_current.duration = timestamp - m_current.start;
+  m_current.rpm = (!m_current.partial && m_current.duration > 0) ? float(60e6 / double(m_current.duration)) : 0.0f;
+  m_current.missing = m_spokes - m_current.received;
+
+  m_current.gaps.clear();
+  m_current.gapCount = 0;
+  //Runs are followed from the first spoke received, so a run across north is one gap, listed last.
+  uint32_t start = 0;
+  while (start < m_spokes && m_seen[start] == 0) start++;
+  if (start == m_spokes) start = 0;
+  uint32_t offset = 0;
+  while (offset < m_spokes) {
+    if (m_seen[(start + offset) % m_spokes] != 0) {
+      offset++;
+      continue;
+    }
+    uint32_t const first = offset;
+    while (offset < m_spokes && m_seen[(start + offset) % m_spokes] == 0) offset++;
+    m_current.gapCount++;
+    if (m_current.gaps.size() < m_maxGaps) m_current.gaps.push_back(SpokeGap{uint16_t((start + first) % m_spokes), uint16_t(offset - first)});
+  }
+
+  //Swapped so the gap lists keep their storage.
+  std::swap(m_last, m_current);
+  m_current.start = timestamp;
+  m_current.received = 0;
+  m_current.duplicates = 0;
+  m_current.late = 0;
+  m_current.rejected = 0;
+  std::fill(m_seen.begin(), m_seen.end(), uint8_t(0));
+}
+
+SweepInfo const &SweepAssembler::last() const noexcept {
+  return m_last;
+}
+
+uint64_t SweepAssembler::sweeps() const noexcept {
+  return m_sweeps;
+}
+
+uint32_t SweepAssembler::received() const noexcept {
+  return m_current.received;
+}
+
+uint16_t SweepAssembler::spokes() const noexcept {
+  return m_spokes;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SWEEP_ASSEMBLER
+#define SWEEP_ASSEMBLER
+
+#include <cstdint>
+#include <vector>
+
+//Run of spokes missing from a sweep, count spokes from first. A run across north starts before it and wraps to 0.
+struct SpokeGap {
+  uint16_t first{0};
+  uint16_t count{0};
+};
+
+//A completed sweep.
+struct SweepInfo {
+  uint64_t sweep{0};
+  //Times in microseconds of the first spoke of the sweep and of the first spoke of the next one.
+  int64_t start{0};
+  int64_t end{0};
+  int64_t duration{0};
+  //0 for a partial sweep.
+  float rpm{0};
+  //Different spokes received, and spokes of the revolution never received.
+  uint32_t received{0};
+  uint32_t missing{0};
+  //Spokes received again, and spokes arriving just behind the newest one.
+  uint32_t duplicates{0};
+  uint32_t late{0};
+  //Jumps that were not confirmed by the spokes after them, such as dropped packets reading azimuth 0.
+  uint32_t rejected{0};
+  //The first sweep after start-up or after a confirmed jump past north does not cover a whole revolution.
+  bool partial{false};
+  //At most maxGaps runs of missing spokes; gapCount counts all of them.
+  std::vector<SpokeGap> gaps{};
+  uint32_t gapCount{0};
+};
+
+//Finds the sweeps in the stream of spokes. Spokes move forward around the circle; a step forward of up to window
+//spokes is taken at once, and a sweep is completed when such a step passes north. A larger step is only taken when
+//the next confirm spokes carry on from it, so a single stray azimuth cannot end a sweep, and small steps back are
+//counted as late instead of starting a new sweep.
+class SweepAssembler {
+ public:
+  SweepAssembler(uint16_t spokes = 2048, uint16_t window = 128, uint8_t confirm = 3, uint32_t maxGaps = 64) noexcept;
+
+  //Adds a spoke received at timestamp microseconds. Returns true if it completed a sweep, which last() then
+  //describes.
+  bool add(uint32_t spoke, int64_t timestamp) noexcept;
+
+  SweepInfo const &last() const noexcept;
+  uint64_t sweeps() const noexcept;
+
+  //Different spokes of the sweep in progress.
+  uint32_t received() const noexcept;
+  uint16_t spokes() const noexcept;
+
+ private:
+  bool step(uint32_t spoke, int64_t timestamp) noexcept;
+  void finish(int64_t timestamp) noexcept;
+  uint32_t forward(uint32_t from, uint32_t to) const noexcept;
+
+  uint16_t m_spokes;
+  uint16_t m_window;
+  uint8_t m_confirm;
+  uint32_t m_maxGaps;
+
+  std::vector<uint8_t> m_seen;
+  SweepInfo m_current{};
+  SweepInfo m_last{};
+  uint64_t m_sweeps{0};
+  int32_t m_lastSpoke{-1};
+
+  //Spokes after an unconfirmed jump.
+  std::vector<uint32_t> m_pendingSpokes{};
+  std::vector<int64_t> m_pendingTimes{};
+};
+
+#endif
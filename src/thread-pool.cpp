@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread-pool.hpp"
+
+ThreadPool::ThreadPool(uint32_t threads) noexcept
+  : m_threads((threads > 0) ? threads : ((std::thread::hardware_concurrency() > 0) ? std::thread::hardware_concurrency() : 1)) {
+  for (uint32_t worker = 1; worker < m_threads; worker++) {
+    m_workers.emplace_back([this, worker]() { work(worker); });
+  }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_start.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+uint32_t ThreadPool::threads() const noexcept {
+  return m_threads;
+}
+
+void ThreadPool::parallelFor(uint32_t begin, uint32_t end, std::function<void(uint32_t, uint32_t)> const &fn) noexcept {
+  if (begin >= end) return;
+  if (m_threads == 1) {
+    fn(begin, end);
+    return;
+  }
+
+  std::lock_guard<std::mutex> job(m_jobMutex);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &fn;
+    m_begin = begin;
+    m_end = end;
+    m_pending = m_threads - 1;
+    m_generation++;
+  }
+  m_start.notify_all();
+
+  //The caller works on the first chunk.
+  runChunk(0);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this]() { return m_pending == 0; });
+  m_job = nullptr;
+}
+
+void ThreadPool::runChunk(uint32_t chunk) noexcept {
+  uint64_t const length = m_end - m_begin;
+  uint32_t const chunkBegin = m_begin + uint32_t(length * chunk / m_threads);
+  uint32_t const chunkEnd = m_begin + uint32_t(length * (chunk + 1) / m_threads);
+  if (chunkBegin < chunkEnd) {
+    (*m_job)(chunkBegin, chunkEnd);
+  }
+}
+
+void ThreadPool::work(uint32_t worker) noexcept {
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+      if (m_stop) return;
+      generation = m_generation;
+    }
+
+    runChunk(worker);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending--;
+    }
+    m_done.notify_one();
+  }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed size pool of worker threads for data parallel work. The calling thread takes part in every job, so a pool
+//of one thread runs everything inline.
+class ThreadPool {
+ private:
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&)      = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+ public:
+  //threads is the total number of threads working on a job, including the caller. 0 uses one per core.
+  explicit ThreadPool(uint32_t threads) noexcept;
+  ~ThreadPool() noexcept;
+
+  uint32_t threads() const noexcept;
+
+  //Splits [begin, end) into one contiguous chunk per thread, runs fn(chunkBegin, chunkEnd) on each and returns
+  //when all chunks are done. Jobs submitted from several threads run one after another.
+  void parallelFor(uint32_t begin, uint32_t end, std::function<void(uint32_t, uint32_t)> const &fn) noexcept;
+
+ private:
+  void work(uint32_t worker) noexcept;
+  void runChunk(uint32_t chunk) noexcept;
+
+ private:
+  uint32_t m_threads;
+  std::vector<std::thread> m_workers{};
+
+  std::mutex m_jobMutex{};
+  std::mutex m_mutex{};
+  std::condition_variable m_start{};
+  std::condition_variable m_done{};
+
+  std::function<void(uint32_t, uint32_t)> const *m_job{nullptr};
+  uint32_t m_begin{0};
+  uint32_t m_end{0};
+  uint64_t m_generation{0};
+  uint32_t m_pending{0};
+  bool m_stop{false};
+};
+
+#endif
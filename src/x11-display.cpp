@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <cstring>
+
+#include "x11-display.hpp"
+
+//Errors from the server arrive asynchronously and the default handler exits, so they are caught while MIT-SHM is set up.
+static bool s_xError = false;
+
+static int trapXError(Display *, XErrorEvent *) {
+  s_xError = true;
+  return 0;
+}
+
+char const *backendName(X11Backend backend) noexcept {
+  switch (backend) {
+    case X11Backend::SharedImage: return "xshm";
+    case X11Backend::SharedCopy: return "xshm-copy";
+    case X11Backend::Put: return "xputimage";
+    default: return "none";
+  }
+}
+
+X11Display::X11Display(cluon::SharedMemory &image, uint16_t c_width, uint16_t c_height, bool preferShm) noexcept
+  : m_image(image)
+  , m_width(c_width)
+  , m_height(c_height) {
+  m_display = XOpenDisplay(nullptr);
+  if (m_display == nullptr || !m_image.valid()) return;
+
+  int const screen = DefaultScreen(m_display);
+  m_window = XCreateSimpleWindow(m_display, RootWindow(m_display, screen), 0, 0, m_width, m_height, 1, 0, 0);
+  XSelectInput(m_display, m_window, KeyPressMask);
+
+  if (preferShm && attachShm(false)) {
+    m_backend = X11Backend::SharedImage;
+  } else if (preferShm && attachShm(true)) {
+    m_backend = X11Backend::SharedCopy;
+  } else {
+    m_ximage = XCreateImage(m_display, DefaultVisual(m_display, screen), 24, ZPixmap, 0, m_image.data(), m_width,
+      m_height, 32, m_width * 4);
+    m_backend = (m_ximage != nullptr) ? X11Backend::Put : X11Backend::Disabled;
+  }
+}
+
+X11Display::~X11Display() {
+  if (m_display == nullptr) return;
+  if (m_backend == X11Backend::SharedImage || m_backend == X11Backend::SharedCopy) {
+    XShmDetach(m_display, &m_shmInfo);
+    XSync(m_display, False);
+    if (m_backend == X11Backend::SharedCopy) shmdt(m_shmInfo.shmaddr);
+  }
+  if (m_ximage != nullptr) {
+    //The pixels belong to the shared memory, not to Xlib.
+    m_ximage->data = nullptr;
+    XDestroyImage(m_ximage);
+  }
+  if (m_window != 0) XDestroyWindow(m_display, m_window);
+  XCloseDisplay(m_display);
+}
+
+//Sets up MIT-SHM over the image segment itself, or with ownSegment over a new private segment. The image segment can
+//only be shared when cluon uses SysV shared memory, whose key comes from the token file at the segment name.
+bool X11Display::attachShm(bool ownSegment) noexcept {
+  if (!XShmQueryExtension(m_display)) return false;
+
+  uint32_t const bytes = uint32_t(m_width) * m_height * 4;
+  if (ownSegment) {
+    m_shmInfo.shmid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+    if (m_shmInfo.shmid == -1) return false;
+    void *addr = shmat(m_shmInfo.shmid, nullptr, 0);
+    if (addr == reinterpret_cast<void *>(-1)) {
+      shmctl(m_shmInfo.shmid, IPC_RMID, nullptr);
+      return false;
+    }
+    m_shmInfo.shmaddr = static_cast<char *>(addr);
+  } else {
+    key_t const key = ftok(m_image.name().c_str(), 1);
+    if (key == -1) return false;
+    m_shmInfo.shmid = shmget(key, 0, 0);
+    struct shmid_ds info;
+    if (m_shmInfo.shmid == -1 || shmctl(m_shmInfo.shmid, IPC_STAT, &info) == -1 || info.shm_segsz < bytes) return false;
+    m_shmInfo.shmaddr = m_image.data();
+  }
+  m_shmInfo.readOnly = True;
+
+  int const screen = DefaultScreen(m_display);
+  m_ximage = XShmCreateImage(m_display, DefaultVisual(m_display, screen), 24, ZPixmap, nullptr, &m_shmInfo, m_width,
+    m_height);
+  bool ok = (m_ximage != nullptr) && (m_ximage->bytes_per_line == int(m_width) * 4);
+  if (ok) {
+    m_ximage->data = m_shmInfo.shmaddr;
+    XSync(m_display, False);
+    s_xError = false;
+    XErrorHandler const previous = XSetErrorHandler(trapXError);
+    ok = XShmAttach(m_display, &m_shmInfo);
+    XSync(m_display, False);
+    ok = ok && !s_xError;
+    XSetErrorHandler(previous);
+  }
+
+  if (ownSegment) {
+    //Removed once both this process and the server have detached.
+    shmctl(m_shmInfo.shmid, IPC_RMID, nullptr);
+    if (!ok) shmdt(m_shmInfo.shmaddr);
+  }
+  if (!ok && m_ximage != nullptr) {
+    m_ximage->data = nullptr;
+    XDestroyImage(m_ximage);
+    m_ximage = nullptr;
+  }
+  return ok;
+}
+
+bool X11Display::valid() const noexcept {
+  return m_backend != X11Backend::Disabled;
+}
+
+X11Backend X11Display::backend() const noexcept {
+  return m_backend;
+}
+
+Display *X11Display::display() const noexcept {
+  return m_display;
+}
+
+Window X11Display::window() const noexcept {
+  return m_window;
+}
+
+bool X11Display::nextKey(char &key) noexcept {
+  if (!valid()) return false;
+  while (XPending(m_display) > 0) {
+    XEvent event;
+    XNextEvent(m_display, &event);
+    if (event.type != KeyPress) continue;
+    char text[4];
+    if (XLookupString(&event.xkey, text, sizeof(text), nullptr, nullptr) > 0) {
+      key = text[0];
+      return true;
+    }
+  }
+  return false;
+}
+
+void X11Display::put(Rect const &r) noexcept {
+  GC const gc = DefaultGC(m_display, DefaultScreen(m_display));
+  if (m_backend == X11Backend::Put) {
+    XPutImage(m_display, m_window, gc, m_ximage, r.x, r.y, r.x, r.y, r.width, r.height);
+    return;
+  }
+  if (m_backend == X11Backend::SharedCopy) {
+    uint32_t const stride = uint32_t(m_width) * 4;
+    for (uint32_t y = r.y; y < uint32_t(r.y) + r.height; y++) {
+      uint32_t const offset = y * stride + uint32_t(r.x) * 4;
+      std::memcpy(m_shmInfo.shmaddr + offset, m_image.data() + offset, uint32_t(r.width) * 4);
+    }
+  }
+  XShmPutImage(m_display, m_window, gc, m_ximage, r.x, r.y, r.x, r.y, r.width, r.height, False);
+}
+
+void X11Display::show() noexcept {
+  show(std::vector<Rect>{Rect{0, 0, m_width, m_height}});
+}
+
+void X11Display::show(std::vector<Rect> const &rects) noexcept {
+  if (!valid()) return;
+  if (!m_mapped) {
+    XMapWindow(m_display, m_window);
+    m_mapped = true;
+  }
+  for (Rect const &r : rects) put(r);
+  //With MIT-SHM the server reads the pixels after the request, so wait for it before the image changes again.
+  if (m_backend == X11Backend::Put) {
+    XFlush(m_display);
+  } else {
+    XSync(m_display, False);
+  }
+}
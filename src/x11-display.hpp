@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef X11_DISPLAY
+#define X11_DISPLAY
+
+#include "cluon-complete.hpp"
+#include "dirty-region.hpp"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#include <cstdint>
+#include <vector>
+
+//How the image reaches the X server.
+enum class X11Backend {
+  //MIT-SHM over the image's own shared memory segment. The server reads the rendered image directly.
+  SharedImage,
+  //MIT-SHM over a segment of the display's own. Changed rectangles are copied into it before each push.
+  SharedCopy,
+  //XPutImage. Every pushed pixel is written through the X connection. Works with remote displays.
+  Put,
+  //No X display could be opened.
+  Disabled
+};
+
+char const *backendName(X11Backend backend) noexcept;
+
+//Window showing a c_width * c_height * 4 byte image held in cluon shared memory. With preferShm the MIT-SHM extension
+//is tried first and any failure to set it up falls back to XPutImage, so the same build runs on local and remote
+//displays.
+class X11Display {
+ private:
+  X11Display(const X11Display &) = delete;
+  X11Display(X11Display &&)      = delete;
+  X11Display &operator=(const X11Display &) = delete;
+  X11Display &operator=(X11Display &&) = delete;
+
+ public:
+  X11Display(cluon::SharedMemory &image, uint16_t c_width, uint16_t c_height, bool preferShm = true) noexcept;
+  ~X11Display();
+
+  //False when the X display could not be opened; show() then does nothing.
+  bool valid() const noexcept;
+  X11Backend backend() const noexcept;
+
+  //Pushes the whole image to the window and waits until the server has read it.
+  void show() noexcept;
+
+  //Pushes only the given rectangles.
+  void show(std::vector<Rect> const &rects) noexcept;
+
+  //Takes the next key typed into the window without waiting. False when there is none.
+  bool nextKey(char &key) noexcept;
+
+  Display *display() const noexcept;
+  Window window() const noexcept;
+
+ private:
+  bool attachShm(bool ownSegment) noexcept;
+  void put(Rect const &r) noexcept;
+
+  cluon::SharedMemory &m_image;
+  uint16_t m_width;
+  uint16_t m_height;
+  Display *m_display{nullptr};
+  Window m_window{0};
+  XImage *m_ximage{nullptr};
+  XShmSegmentInfo m_shmInfo{};
+  X11Backend m_backend{X11Backend::Disabled};
+  bool m_mapped{false};
+};
+
+#endif
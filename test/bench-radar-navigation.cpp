@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2021  Krister Blanch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include "aggregate-renderer.hpp"
+#include "dirty-region.hpp"
+#include "radar-decoder.hpp"
+#include "renderer.hpp"
+#include "sample-format.hpp"
+#include "scan-table-cache.hpp"
+#include "sector-decoder.hpp"
+#include "shared-scan-table.hpp"
+#include "spoke-kernel.hpp"
+#ifdef HAVE_X11
+#include "x11-display.hpp"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define radians(a) (((a)*M_PI)/180)
+
+//Benchmarks for the decoder. Not part of the test runner; run manually with an optional number of sweeps:
+//  ./opendlv-device-radar-navigation-bench [sweeps]
+
+static uint16_t const origin = 512;
+static uint16_t const c_width = 1024;
+static uint16_t const c_height = 1024;
+
+//Same pixel map as built by main()
+static void buildAddressBook(uint16_t addBk[2048][512*2]) {
+  for (int i = 0; i <= 4095; i++){
+    for (int j = 0; j<= 511; j++) {
+      uint16_t distance = j;
+      float angle = (float(i)/4096*360);
+      float angle_rad = float(radians(angle));
+      addBk[i/2][j*2] = static_cast<uint16_t>(std::round(origin+((std::sin(angle_rad)*distance))));
+      addBk[i/2][(j*2)+1] = static_cast<uint16_t>(std::round(origin-((std::cos(angle_rad)*distance))));
+    }
+  }
+}
+
+//The decoder hot loop on the interleaved x/y pixel map: bounds checks and index arithmetic per sample. 
+//With perSample set it also locks, unlocks and notifies for every sample, as before spoke-granular commits.
+static int decodeXY(opendlv::proxy::RadarDetectionReading msg, std::unique_ptr<cluon::SharedMemory> &shmArgb, uint16_t addBk[2048][512*2], bool perSample) {
+  std::string packet = msg.data();
+  if (!perSample) shmArgb->lock();
+  int k = 1;
+  for (uint32_t i = 0; i < packet.size(); i = i+k) {
+    if (i > (packet.size()/3*2)) k = 2;
+    uint8_t current_strength = static_cast<uint8_t>(packet[i]);
+    uint16_t x = addBk[int(msg.azimuth())/2][i*2];
+    uint16_t y = addBk[int(msg.azimuth())/2][(i*2)+1];
+    if (x > c_width || y > c_height) {
+      if (!perSample) shmArgb->unlock();
+      return (-9);
+    }
+    uint32_t index = ((4*x)+(1024*y)*4);
+    if (perSample) shmArgb->lock();
+    shmArgb->data()[index+2] = static_cast<char>(current_strength);
+    if (current_strength == uint8_t(255)) {
+      current_strength = uint8_t(0);
+    } else if (current_strength == 0) {
+      current_strength = 255;
+    }
+    shmArgb->data()[index+1] = static_cast<char>(current_strength);
+    shmArgb->data()[index] = static_cast<char>(current_strength);
+    shmArgb->data()[index+3] = char(0);
+    if (perSample) {
+      shmArgb->unlock();
+      shmArgb->notifyAll();
+    }
+  }
+  if (!perSample) {
+    shmArgb->unlock();
+    shmArgb->notifyAll();
+  }
+  return (int(msg.azimuth()));
+}
+
+//Runs fn over every spoke of the given number of sweeps and reports the sample rate.
+template <typename F>
+static double benchmark(std::string const &label, std::vector<opendlv::proxy::RadarDetectionReading> &spokes, uint32_t sweeps, F fn) {
+  uint64_t samples = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < sweeps; s++) {
+    for (auto &msg : spokes) {
+      fn(msg);
+      samples += msg.data().size();
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  double rate = double(samples) / elapsed.count();
+  std::cout << label << ": " << rate / 1e6 << " Msamples/s (" << elapsed.count() * 1000 / sweeps << " ms/sweep)" << std::endl;
+  return rate;
+}
+
+int32_t main(int32_t argc, char **argv) {
+  uint32_t const sweeps{(argc > 1) ? static_cast<uint32_t>(std::stoi(argv[1])) : 20};
+
+  //Table build time: the x/y map with sin and cos per bin against the octant table and its expansion.
+  auto buildStart = std::chrono::steady_clock::now();
+  std::unique_ptr<uint16_t[][512*2]> addBk{new uint16_t[2048][512*2]};
+  buildAddressBook(addBk.get());
+  std::chrono::duration<double> buildElapsed = std::chrono::steady_clock::now() - buildStart;
+  std::cout << "x/y map build: " << buildElapsed.count() * 1000 << " ms" << std::endl;
+
+  buildStart = std::chrono::steady_clock::now();
+  OctantTable octant;
+  buildElapsed = std::chrono::steady_clock::now() - buildStart;
+  std::cout << "octant table build: " << buildElapsed.count() * 1000 << " ms (" << octant.size() / 1024 << " KiB)" << std::endl;
+
+  buildStart = std::chrono::steady_clock::now();
+  ScanTable table{octant, origin, c_width, c_height};
+  buildElapsed = std::chrono::steady_clock::now() - buildStart;
+  std::cout << "scan table expansion: " << buildElapsed.count() * 1000 << " ms" << std::endl;
+
+  //A 4096 spoke by 1024 bin radar on a 2048 pixel canvas, whose stride is compiled in, and on one two pixels wider.
+  OctantTable const large{4096, 1024};
+  for (uint16_t width : {uint16_t(2048), uint16_t(2050)}) {
+    buildStart = std::chrono::steady_clock::now();
+    ScanTable const expanded{large, 1024, width, 2048};
+    buildElapsed = std::chrono::steady_clock::now() - buildStart;
+    std::cout << "scan table expansion 4096x1024, " << width << " wide" << (expanded.valid() ? "" : " (invalid)") << ": " << buildElapsed.count() * 1000 << " ms" << std::endl;
+  }
+
+  //A second instance with the same geometry maps the table the first one built.
+  SharedScanTable builder{origin, c_width, c_height};
+  buildStart = std::chrono::steady_clock::now();
+  SharedScanTable attached{origin, c_width, c_height};
+  buildElapsed = std::chrono::steady_clock::now() - buildStart;
+  std::cout << "shared scan table " << (attached.attached() ? "attach" : "build") << ": " << buildElapsed.count() * 1000 << " ms" << std::endl;
+
+  //Range switches: the first visit to a range builds its tables, a switch back to a kept range is a lookup.
+  ScanTableCache cache{origin, c_width, c_height, 2048, 512, 0.0f, 4, false, Aggregation::Max};
+  for (float range : {1500.0f, 750.0f, 3000.0f}) {
+    buildStart = std::chrono::steady_clock::now();
+    cache.tables(range);
+    buildElapsed = std::chrono::steady_clock::now() - buildStart;
+    std::cout << "range " << range << " m tables build: " << buildElapsed.count() * 1000 << " ms" << std::endl;
+  }
+  buildStart = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < sweeps; s++) cache.tables((s % 2 == 0) ? 1500.0f : 750.0f);
+  buildElapsed = std::chrono::steady_clock::now() - buildStart;
+  std::cout << "range switch to a kept range: " << buildElapsed.count() * 1000000 / sweeps << " us" << std::endl;
+
+  std::unique_ptr<cluon::SharedMemory> shmArgb{
+    new cluon::SharedMemory{"/bench.argb", c_width * c_height * 4}};
+
+  //One full sweep of 512 sample spokes with a repeating strength pattern.
+  std::vector<opendlv::proxy::RadarDetectionReading> spokes;
+  for (uint32_t azimuth = 2; azimuth < 4096; azimuth += 2) {
+    std::string payload(512, '\0');
+    for (uint32_t i = 0; i < payload.size(); i++) {
+      payload[i] = static_cast<char>((i * 7 + azimuth) & 0xff);
+    }
+    opendlv::proxy::RadarDetectionReading msg;
+    msg.azimuth(float(azimuth));
+    msg.data(payload);
+    msg.range(1500);
+    spokes.push_back(msg);
+  }
+
+  std::cout << "Decoding " << sweeps << " sweeps of " << spokes.size() << " spokes" << std::endl;
+
+  double before = benchmark("x/y map, per-sample commit", spokes, sweeps, [&](opendlv::proxy::RadarDetectionReading &msg) {
+    decodeXY(msg, shmArgb, addBk.get(), true);
+  });
+
+  benchmark("x/y map, per-spoke commit", spokes, sweeps, [&](opendlv::proxy::RadarDetectionReading &msg) {
+    decodeXY(msg, shmArgb, addBk.get(), false);
+  });
+
+  SpokeCommit perSpoke;
+  double after = benchmark("scan table, per-spoke commit", spokes, sweeps, [&](opendlv::proxy::RadarDetectionReading &msg) {
+    decode(msg, shmArgb, table, false, origin, c_height, c_width, perSpoke);
+  });
+
+  SpokeCommit perSector;
+  perSector.sectorSpokes = 64;
+  double sectored = benchmark("scan table, per-sector commit (64 spokes)", spokes, sweeps, [&](opendlv::proxy::RadarDetectionReading &msg) {
+    decode(msg, shmArgb, table, false, origin, c_height, c_width, perSector);
+  });
+
+  //Byte views straight into the payloads, as the service does with serialized envelopes.
+  Palette const palette = defaultPalette();
+  std::vector<std::string> payloads;
+  for (auto &msg : spokes) payloads.push_back(msg.data());
+  SpokeCommit viewCommit;
+  uint64_t viewSamples = 0;
+  auto viewStart = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < sweeps; s++) {
+    for (uint32_t i = 0; i < spokes.size(); i++) {
+      SpokeView view;
+      view.data = reinterpret_cast<uint8_t const*>(payloads[i].data());
+      view.length = uint32_t(payloads[i].size());
+      view.azimuth = spokes[i].azimuth();
+      view.range = spokes[i].range();
+      decode(view, shmArgb, table, palette, false, origin, c_height, c_width, viewCommit);
+      viewSamples += view.length;
+    }
+  }
+  std::chrono::duration<double> viewElapsed = std::chrono::steady_clock::now() - viewStart;
+  std::cout << "scan table, byte view: " << double(viewSamples) / viewElapsed.count() / 1e6 << " Msamples/s (" << viewElapsed.count() * 1000 / sweeps << " ms/sweep)" << std::endl;
+
+  //Polar buffer as the primary store, with one render per revolution.
+  PolarBuffer polar;
+  uint64_t polarSamples = 0;
+  auto polarStart = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < sweeps; s++) {
+    for (uint32_t i = 0; i < spokes.size(); i++) {
+      SpokeView view;
+      view.data = reinterpret_cast<uint8_t const*>(payloads[i].data());
+      view.length = uint32_t(payloads[i].size());
+      view.azimuth = spokes[i].azimuth();
+      decode(view, polar, false);
+      polarSamples += view.length;
+    }
+    shmArgb->lock();
+    renderDirty(polar, table, palette, shmArgb->data());
+    shmArgb->unlock();
+    shmArgb->notifyAll();
+  }
+  std::chrono::duration<double> polarElapsed = std::chrono::steady_clock::now() - polarStart;
+  std::cout << "polar buffer, render per sweep: " << double(polarSamples) / polarElapsed.count() / 1e6 << " Msamples/s (" << polarElapsed.count() * 1000 / sweeps << " ms/sweep)" << std::endl;
+
+  //Full frames from the polar buffer: forward scatter against the inverse gather on 1 to n threads.
+  auto frameStart = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < sweeps; s++) renderAll(polar, table, palette, shmArgb->data());
+  std::chrono::duration<double> frameElapsed = std::chrono::steady_clock::now() - frameStart;
+  std::cout << "forward renderer, full frame: " << frameElapsed.count() * 1000 / sweeps << " ms/frame" << std::endl;
+
+  //Aggregating renderers: one store per covered pixel, full frames and one display interval of 85 dirty spokes.
+  for (Aggregation mode : {Aggregation::Last, Aggregation::Max, Aggregation::Mean}) {
+    buildStart = std::chrono::steady_clock::now();
+    AggregateRenderer aggregate{table, mode};
+    buildElapsed = std::chrono::steady_clock::now() - buildStart;
+    frameStart = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sweeps; s++) aggregate.renderAll(polar, palette, shmArgb->data());
+    frameElapsed = std::chrono::steady_clock::now() - frameStart;
+    auto dirtyStart = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sweeps; s++) {
+      for (uint32_t i = 0; i < 85; i++) polar.markDirty((s * 85 + i) % polar.spokes());
+      aggregate.renderDirty(polar, palette, shmArgb->data());
+    }
+    std::chrono::duration<double> dirtyElapsed = std::chrono::steady_clock::now() - dirtyStart;
+    FanInTable const &fanIn = aggregate.fanIn();
+    std::cout << "aggregate renderer " << aggregationName(mode) << ", full frame: " << frameElapsed.count() * 1000 / sweeps << " ms/frame, 85 spokes: " << dirtyElapsed.count() * 1000 / sweeps << " ms (table " << buildElapsed.count() * 1000 << " ms, " << fanIn.sharedPixels() << " shared pixels)" << std::endl;
+  }
+  FanInTable const fanIn{table};
+  uint64_t const stores = uint64_t(table.spokes()) * table.bins();
+  uint64_t repeated = 0;
+  for (uint32_t pixel = 0; pixel < fanIn.sharedPixels(); pixel++) repeated += fanIn.sourceCount(pixel) - 1;
+  std::cout << "forward renderer stores per frame: " << stores << " plain, " << stores - repeated << " aggregated" << std::endl;
+
+  InverseScanTable inverse{origin, c_width, c_height};
+  for (uint32_t threads = 1; threads <= std::thread::hardware_concurrency(); threads *= 2) {
+    ThreadPool pool{threads};
+    frameStart = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sweeps; s++) renderInverse(polar, inverse, palette, shmArgb->data(), pool);
+    frameElapsed = std::chrono::steady_clock::now() - frameStart;
+    std::cout << "inverse renderer, " << threads << " threads: " << frameElapsed.count() * 1000 / sweeps << " ms/frame" << std::endl;
+  }
+
+  //Sector decode workers against thread count, for this radar and for a 4096 spoke by 1024 bin one.
+  for (uint16_t spokeCount : {uint16_t(2048), uint16_t(4096)}) {
+    uint16_t const binCount = uint16_t(spokeCount / 4);
+    uint16_t const size = uint16_t(binCount * 2);
+    ScanTable sectorTable{binCount, size, size, spokeCount, binCount};
+    std::vector<char> sectorCanvas(sectorTable.canvasSize(), 0);
+    std::vector<std::string> sectorPayloads;
+    for (uint32_t i = 0; i < spokeCount; i++) {
+      std::string payload(binCount, '\0');
+      for (uint32_t j = 0; j < payload.size(); j++) payload[j] = static_cast<char>((j * 7 + i) & 0xff);
+      sectorPayloads.push_back(payload);
+    }
+    uint32_t const maxWorkers = (std::thread::hardware_concurrency() > 4) ? std::thread::hardware_concurrency() : 4;
+    for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+      PolarBuffer sectorPolar{spokeCount, binCount};
+      SectorDecoder sectorDecoder{sectorTable, std::make_shared<Palette const>(palette), sectorPolar, sectorCanvas.data(), workers};
+      uint64_t sectorSamples = 0;
+      auto sectorStart = std::chrono::steady_clock::now();
+      for (uint32_t s = 0; s < sweeps; s++) {
+        for (uint32_t i = 0; i < spokeCount; i++) {
+          SpokeView view;
+          view.data = reinterpret_cast<uint8_t const*>(sectorPayloads[i].data());
+          view.length = binCount;
+          view.azimuth = float((i == 0) ? 4096 : i * 4096 / spokeCount);
+          while (sectorDecoder.push(view) == -14) std::this_thread::yield();
+          sectorSamples += view.length;
+        }
+      }
+      sectorDecoder.drain();
+      std::chrono::duration<double> sectorElapsed = std::chrono::steady_clock::now() - sectorStart;
+      std::cout << "sector decoders " << spokeCount << "x" << binCount << ", " << workers << " workers: " << double(sectorSamples) / sectorElapsed.count() / 1e6 << " Msamples/s (" << sectorElapsed.count() * 1000 / sweeps << " ms/sweep)" << std::endl;
+    }
+  }
+
+  //Display upload per push, one push per 85 spokes as in the service, against the full image.
+  SpokeBounds spokeBounds{table};
+  DirtyRegion dirtyRegion{spokeBounds};
+  uint64_t pushedPixels = 0;
+  uint32_t pushes = 0;
+  for (uint32_t spoke = 0; spoke < table.spokes(); spoke++) {
+    dirtyRegion.add(spoke);
+    if ((spoke + 1) % 85 == 0 || spoke + 1 == table.spokes()) {
+      pushedPixels += dirtyRegion.area();
+      pushes++;
+      dirtyRegion.clear();
+    }
+  }
+  std::cout << "display push: " << double(pushedPixels) * 4 / pushes / 1024 << " KiB per push against " << double(c_width) * c_height * 4 / 1024 << " KiB full" << std::endl;
+
+#ifdef HAVE_X11
+  //Display backends, full frames and one push per 85 spokes, in frames per second and process CPU time per frame.
+  //Needs an X server, such as Xvfb.
+  for (bool preferShm : {true, false}) {
+    X11Display x11{*shmArgb, c_width, c_height, preferShm};
+    if (!x11.valid()) {
+      std::cout << "display backends: no X display" << std::endl;
+      break;
+    }
+    for (bool full : {true, false}) {
+      uint32_t const frames = sweeps * 10;
+      std::clock_t const cpuStart = std::clock();
+      auto start = std::chrono::steady_clock::now();
+      for (uint32_t f = 0; f < frames; f++) {
+        if (full) {
+          x11.show();
+          continue;
+        }
+        dirtyRegion.clear();
+        for (uint32_t i = 0; i < 85; i++) dirtyRegion.add((f * 85 + i) % table.spokes());
+        x11.show(dirtyRegion.rects());
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      double const cpu = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+      std::cout << "display " << backendName(x11.backend()) << (full ? ", full frame: " : ", dirty rects: ") << frames / elapsed.count() << " frames/s, " << cpu * 1000 / frames << " ms CPU/frame" << std::endl;
+    }
+  }
+#endif
+
+  std::cout << "Speedup per-spoke: " << after / before << "x, per-sector: " << sectored / before << "x" << std::endl;
+
+  //Scatter kernels on their own, without message handling and locking.
+  std::vector<uint8_t> strengths(table.bins());
+  for (uint32_t i = 0; i < strengths.size(); i++) strengths[i] = static_cast<uint8_t>((i * 7) & 0xff);
+  for (int level = 0; level <= int(detectKernelLevel()); level++) {
+    ScatterKernel kernel = scatterKernel(KernelLevel(level));
+    uint64_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sweeps * 10; s++) {
+      for (uint32_t spoke = 0; spoke < table.spokes(); spoke++) {
+        kernel(shmArgb->data(), table.spoke(spoke), strengths.data(), table.bins(), palette.argb);
+        samples += table.bins();
+      }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "scatter kernel " << kernelName(KernelLevel(level)) << ": " << double(samples) / elapsed.count() / 1e6 << " Msamples/s" << std::endl;
+  }
+
+  //4 bit unpacking of 512 byte spokes into 1024 samples, per kernel.
+  std::vector<uint8_t> unpacked(1024);
+  for (int level = 0; level <= int(detectKernelLevel()); level++) {
+    UnpackKernel kernel = unpackKernel(SampleFormat::Nibble, KernelLevel(level));
+    uint64_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t s = 0; s < sweeps * 10; s++) {
+      for (uint32_t spoke = 0; spoke < table.spokes(); spoke++) {
+        kernel(strengths.data(), uint32_t(unpacked.size()), unpacked.data());
+        samples += unpacked.size();
+      }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "4 bit unpack " << kernelName(KernelLevel(level)) << ": " << double(samples) / elapsed.count() / 1e6 << " Msamples/s" << std::endl;
+  }
+  return 0;
+}
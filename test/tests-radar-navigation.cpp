@@ -16,22 +16,75 @@
  */
 
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // SIGSTKSZ is no longer a constant expression on glibc >= 2.34
 
 #include "catch.hpp"
 
 #include "cluon-complete.hpp"
 #include "opendlv-standard-message-set.hpp"
 
+#include "aggregate-renderer.hpp"
+#include "dirty-region.hpp"
+#include "frame-mailbox.hpp"
+#include "frame-publisher.hpp"
+#include "navigation-state.hpp"
+#include "radar-channel.hpp"
 #include "radar-decoder.hpp"
-
+#include "radar-frame-reader.hpp"
+#include "renderer.hpp"
+#include "sample-format.hpp"
+#include "scan-table-cache.hpp"
+#include "sector-decoder.hpp"
+#include "shared-scan-table.hpp"
+#include "spoke-kernel.hpp"
+#include "spoke-queue.hpp"
+#include "spoke-throttle.hpp"
+#include "sweep-assembler.hpp"
+#ifdef HAVE_X11
+#include "x11-display.hpp"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <new>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define radians(a) (((a)*M_PI)/180)
 
 using namespace std::chrono_literals;
 
+//Counts the heap allocations made by the test runner, for the allocation free decode path.
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(std::size_t size) {
+  allocations++;
+  void *memory = std::malloc(size ? size : 1);
+  if (memory == nullptr) throw std::bad_alloc();
+  return memory;
+}
+
+//GCC pairs the std::free below with the operator new it inlines at each call site and takes them for mismatched,
+//not seeing that both are replaced here.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
 /////// Tests for verifying Test lib /////
 
 TEST_CASE("Test the tester - Validate the Test Oracle") {
@@ -63,7 +116,7 @@ TEST_CASE("Test 0 - Test decoder with empty payload.") {
   opendlv::proxy::RadarDetectionReading msg;
   msg.azimuth(5);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
   uint16_t origin = 512; 
   uint16_t c_height = 1024;
@@ -72,7 +125,7 @@ TEST_CASE("Test 0 - Test decoder with empty payload.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_0.argb", c_width * c_height * 4}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   
   std::cout << "Test Case 0. Expected: -1" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
@@ -102,7 +155,7 @@ TEST_CASE("Test 1 - Test decoder with sample payload.") {
   msg.data(payload);
   msg.range(1500);
   
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
 
   bool verbose = false;
   uint16_t origin = 512; 
@@ -112,44 +165,8 @@ TEST_CASE("Test 1 - Test decoder with sample payload.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_1{
     new cluon::SharedMemory{"/Test_1.argb", c_width * c_height * 4}};
 
-  for (int i = 0; i <= 4095; i++){
-    for (int j = 0; j<= 511; j++) {
-      uint16_t distance = j;
-      float angle = (float(i)/4096*360);
-      float angle_rad;
-      uint16_t x, y;
-
-      if (angle < 90) {
-        angle_rad = radians(angle);
-        x = round(origin+((sin(angle_rad)*distance)));
-        y = round(origin-((cos(angle_rad)*distance)));
-      }
-      
-      else if (angle < 180) {
-        angle_rad = radians(angle-90);
-        x = round(origin+((cos(angle_rad)*distance)));
-        y = round(origin+((sin(angle_rad)*distance)));
-      }
-      
 
-      else if (angle < 270) {
-        angle_rad = radians(angle-180);
-        x = round(origin-((sin(angle_rad)*distance)));
-        y = round(origin+((cos(angle_rad)*distance)));
-      }
-      
-      else if (angle < 360){
-        angle_rad = radians(angle-270);
-        x = round(origin-((cos(angle_rad)*distance)));
-        y = round(origin-((sin(angle_rad)*distance)));
-      }
-      
-      addBk[i/2][j*2] = x;
-      addBk[i/2][(j*2)+1] = y;
-    }
-  }
-
-  auto retVal = decode(msg, shmArgb_1, addBk, verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_1, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 1. Expected: 1024" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
   REQUIRE(retVal == msg.azimuth());
@@ -170,7 +187,7 @@ TEST_CASE("Test 2 - Test decoder with non-openDLV message payload.") {
   msg.data(payload);
   msg.range(1500);
   
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
 
   bool verbose = false;
   uint16_t origin = 512; 
@@ -180,44 +197,8 @@ TEST_CASE("Test 2 - Test decoder with non-openDLV message payload.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_2{
     new cluon::SharedMemory{"/Test_2.argb", c_width * c_height * 4}};
 
-  for (int i = 0; i <= 4095; i++){
-    for (int j = 0; j<= 511; j++) {
-      uint16_t distance = j;
-      float angle = (float(i)/4096*360);
-      float angle_rad;
-      uint16_t x, y;
-
-      if (angle < 90) {
-        angle_rad = radians(angle);
-        x = round(origin+((sin(angle_rad)*distance)));
-        y = round(origin-((cos(angle_rad)*distance)));
-      }
-      
-      else if (angle < 180) {
-        angle_rad = radians(angle-90);
-        x = round(origin+((cos(angle_rad)*distance)));
-        y = round(origin+((sin(angle_rad)*distance)));
-      }
-      
-
-      else if (angle < 270) {
-        angle_rad = radians(angle-180);
-        x = round(origin-((sin(angle_rad)*distance)));
-        y = round(origin+((cos(angle_rad)*distance)));
-      }
-      
-      else if (angle < 360){
-        angle_rad = radians(angle-270);
-        x = round(origin-((cos(angle_rad)*distance)));
-        y = round(origin-((sin(angle_rad)*distance)));
-      }
-      
-      addBk[i/2][j*2] = x;
-      addBk[i/2][(j*2)+1] = y;
-    }
-  }
 
-  auto retVal = decode(msg, shmArgb_2, addBk, verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_2, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 2. Expected: 1024" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
   REQUIRE(retVal == msg.azimuth());
@@ -247,7 +228,7 @@ std::cout << "Test Case 3 (Exceptional Case). Memory is initialised with incorre
   msg.data(payload);
   msg.range(1500);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
   uint16_t origin = 512; 
   uint16_t c_height = 1024;
@@ -256,7 +237,7 @@ std::cout << "Test Case 3 (Exceptional Case). Memory is initialised with incorre
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_3.argb", 1}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 3. Expected: -11" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
   //Return value of -11 on faulty memory
@@ -283,7 +264,7 @@ TEST_CASE("Test 4 - decoder with empty memory.") {
   msg.data(payload);
   msg.range(1500);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
   uint16_t origin = 512; 
   uint16_t c_height = 1024;
@@ -292,7 +273,7 @@ TEST_CASE("Test 4 - decoder with empty memory.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_4.argb"}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 4. Expected: -2" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
   //Return value of -2 on empty memory
@@ -319,7 +300,7 @@ TEST_CASE("Test 5 - decoder with correct memory.") {
   msg.data(payload);
   msg.range(1500);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = false;
   uint16_t origin = 512; 
   uint16_t c_height = 1024;
@@ -328,7 +309,7 @@ TEST_CASE("Test 5 - decoder with correct memory.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_5.argb", c_height * c_width * 4}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 5. Expected: 5" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
   //Return value of 5 on faulty memory
@@ -358,7 +339,7 @@ TEST_CASE("Test 6 - decoder with faulty variables.") {
   msg.data(payload);
   msg.range(1500);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
 
   //Origin bigger than height or width of the image. 
@@ -369,7 +350,7 @@ TEST_CASE("Test 6 - decoder with faulty variables.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_6.argb", c_height * c_width * 4}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 6. Expected: -6" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
 
@@ -395,7 +376,7 @@ std::cout << "Test Case 7 (Exceptional Case). Injection of empty variables." <<
   msg.data(payload);
   msg.range(1500);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
 
   //origin, height and width are empty;
@@ -406,7 +387,7 @@ std::cout << "Test Case 7 (Exceptional Case). Injection of empty variables." <<
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_7.argb", 16}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 7. Expected: -3" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
   
@@ -432,7 +413,7 @@ TEST_CASE("Test 8 - decoder with correct variables") {
   msg.data(payload);
   msg.range(1500);
 
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = false;
 
   uint16_t origin = 512; 
@@ -442,7 +423,7 @@ TEST_CASE("Test 8 - decoder with correct variables") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_8.argb", c_height * c_width * 4}};
 
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 8. Expected: 42" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
 
@@ -457,7 +438,7 @@ TEST_CASE("Test 9 - decoder injected with corrupted azimuth.") {
   msg.azimuth(5500);
   msg.data(std::string{"Hello!"});
   
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
 
   uint16_t origin = 512; 
@@ -467,7 +448,7 @@ TEST_CASE("Test 9 - decoder injected with corrupted azimuth.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_9.argb", c_height * c_width * 4}};
     
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 9. Expected: -13" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
  
@@ -482,7 +463,7 @@ TEST_CASE("Test 10 - decoder injected with empty azimuth.") {
   msg.azimuth();
   msg.data(std::string{"Hello!"});
   
-  uint16_t addBk[2048][512*2]; 
+  ScanTable table{512, 1024, 1024};
   bool verbose = true;
 
   uint16_t origin = 512; 
@@ -492,10 +473,1646 @@ TEST_CASE("Test 10 - decoder injected with empty azimuth.") {
   std::unique_ptr<cluon::SharedMemory> shmArgb_0{
     new cluon::SharedMemory{"/Test_10.argb", c_height * c_width * 4}};
     
-  auto retVal = decode(msg, shmArgb_0, addBk,  verbose, origin, c_height, c_width);
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
   std::cout << "Test Case 10. Expected: -12" << ". Outcome: " << retVal << std::endl;
   std::cout << std::endl;
  
   REQUIRE (retVal == -12);
 
 }
+
+/////// Tests for the commit policy ///////
+
+TEST_CASE("Test 11 - decoder commits per sector.") {
+  std::cout << "Test Case 11 (Nominal Case). Spokes are grouped into sectors before consumers are notified." << std::endl; 
+  //Expected outcome is msg.azimuth() and the sector of the last spoke recorded in the commit policy.
+
+  opendlv::proxy::RadarDetectionReading msg;
+  msg.azimuth(1024);
+
+  std::vector<uint8_t> sample{
+    0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+    0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+    0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92
+  };
+
+  const std::string payload(reinterpret_cast<char*>(sample.data()), sample.size());
+
+  msg.data(payload);
+  msg.range(1500);
+
+  bool verbose = false;
+  uint16_t origin = 512; 
+  uint16_t c_height = 1024;
+  uint16_t c_width = 1024;
+
+  ScanTable table{origin, c_width, c_height};
+
+  std::unique_ptr<cluon::SharedMemory> shmArgb_0{
+    new cluon::SharedMemory{"/Test_11.argb", uint32_t(c_width) * c_height * 4}};
+
+  SpokeCommit commit;
+  commit.sectorSpokes = 64;
+
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width, commit);
+  std::cout << "Test Case 11. Expected: 1024, sector 8" << ". Outcome: " << retVal << ", sector " << commit.lastSector << std::endl;
+  std::cout << std::endl;
+
+  REQUIRE(retVal == 1024);
+  REQUIRE(commit.lastSector == 8);
+
+  //The strength of the first sample lands at the origin as R, with B and G holding the same value.
+  uint32_t index = (4*origin)+(1024*origin)*4;
+  REQUIRE(uint8_t(shmArgb_0->data()[index+2]) == 0xe7);
+  REQUIRE(uint8_t(shmArgb_0->data()[index]) == 0xe7);
+  REQUIRE(uint8_t(shmArgb_0->data()[index+3]) == 0);
+}
+
+
+/////// Tests for the scan-conversion table ///////
+
+TEST_CASE("Test 12 - scan table offsets.") {
+  std::cout << "Test Case 12 (Nominal Case). Scan table holds byte offsets of the spoke pixels." << std::endl; 
+  //Expected outcome is a valid table where spoke 0 points up and spoke 512 points right.
+
+  ScanTable table{512, 1024, 1024};
+
+  REQUIRE(table.valid());
+  REQUIRE(table.spokes() == 2048);
+  REQUIRE(table.bins() == 512);
+  REQUIRE(table.canvasSize() == 1024 * 1024 * 4);
+
+  //Bin 0 is the origin on every spoke.
+  REQUIRE(table.spoke(0)[0] == (512 + 512 * 1024) * 4);
+  REQUIRE(table.spoke(1500)[0] == (512 + 512 * 1024) * 4);
+
+  //North, east, south and west at a distance of 100 pixels.
+  REQUIRE(table.spoke(0)[100] == (512 + 412 * 1024) * 4);
+  REQUIRE(table.spoke(512)[100] == (612 + 512 * 1024) * 4);
+  REQUIRE(table.spoke(1024)[100] == (512 + 612 * 1024) * 4);
+  REQUIRE(table.spoke(1536)[100] == (412 + 512 * 1024) * 4);
+}
+
+TEST_CASE("Test 13 - decoder with a scan table outside the canvas.") {
+  std::cout << "Test Case 13 (Exceptional Case). Scan table origin places spokes outside the canvas." << std::endl; 
+  //Expected outcome is -9
+
+  opendlv::proxy::RadarDetectionReading msg;
+  msg.azimuth(5);
+  msg.data(std::string{"Hello!"});
+
+  ScanTable table{900, 1024, 1024};
+  REQUIRE(!table.valid());
+
+  bool verbose = true;
+  uint16_t origin = 512; 
+  uint16_t c_height = 1024;
+  uint16_t c_width = 1024;
+
+  std::unique_ptr<cluon::SharedMemory> shmArgb_0{
+    new cluon::SharedMemory{"/Test_13.argb", uint32_t(c_width) * c_height * 4}};
+
+  auto retVal = decode(msg, shmArgb_0, table, verbose, origin, c_height, c_width);
+  std::cout << "Test Case 13. Expected: -9" << ". Outcome: " << retVal << std::endl;
+  std::cout << std::endl;
+
+  REQUIRE(retVal == -9);
+}
+
+
+/////// Tests for the scatter kernels ///////
+
+TEST_CASE("Test 14 - vector scatter kernels match the scalar reference.") {
+  std::cout << "Test Case 14 (Nominal Case). Every kernel supported by this CPU is compared bit for bit with the scalar kernel." << std::endl; 
+  //Expected outcome is identical canvases for every kernel, spoke and length.
+
+  ScanTable table{512, 1024, 1024};
+
+  //Pseudo random strengths and palette, so that every lane and every palette entry is exercised.
+  uint32_t seed = 12345;
+  auto next = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0xff; };
+
+  Palette palette;
+  for (uint32_t i = 0; i < 256; i++) {
+    palette.argb[i] = paletteEntry(uint8_t(next()), uint8_t(next()), uint8_t(next()), uint8_t(next()));
+  }
+  std::vector<uint8_t> strengths(512);
+  for (auto &strength : strengths) strength = uint8_t(next());
+
+  KernelLevel const supported = detectKernelLevel();
+  std::cout << "Test Case 14. Highest supported kernel: " << kernelName(supported) << std::endl;
+
+  for (int level = 0; level <= int(supported); level++) {
+    ScatterKernel kernel = scatterKernel(KernelLevel(level));
+    for (uint32_t const count : {0u, 1u, 15u, 16u, 17u, 31u, 32u, 33u, 100u, 511u, 512u}) {
+      for (uint32_t const spoke : {0u, 300u, 1024u, 2047u}) {
+        std::vector<char> expected(table.canvasSize(), 0);
+        std::vector<char> actual(table.canvasSize(), 0);
+        scatterScalar(expected.data(), table.spoke(spoke), strengths.data(), count, palette.argb);
+        kernel(actual.data(), table.spoke(spoke), strengths.data(), count, palette.argb);
+        REQUIRE(expected == actual);
+      }
+    }
+  }
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 15 - decoder with the default palette.") {
+  std::cout << "Test Case 15 (Nominal Case). Strengths 0 and 255 are swapped in B and G, R holds the strength." << std::endl; 
+  //Expected outcome is msg.azimuth() and the original PPI colouring.
+
+  opendlv::proxy::RadarDetectionReading msg;
+  msg.azimuth(1024);
+  std::vector<uint8_t> sample{0x00, 0xff, 0x42};
+  msg.data(std::string(reinterpret_cast<char*>(sample.data()), sample.size()));
+
+  bool verbose = false;
+  uint16_t origin = 512; 
+  uint16_t c_height = 1024;
+  uint16_t c_width = 1024;
+  ScanTable table{origin, c_width, c_height};
+
+  std::unique_ptr<cluon::SharedMemory> shmArgb_0{
+    new cluon::SharedMemory{"/Test_15.argb", uint32_t(c_width) * c_height * 4}};
+
+  SpokeCommit commit;
+  auto retVal = decode(msg, shmArgb_0, table, defaultPalette(), verbose, origin, c_height, c_width, commit);
+  std::cout << "Test Case 15. Expected: 1024" << ". Outcome: " << retVal << std::endl;
+  std::cout << std::endl;
+  REQUIRE(retVal == 1024);
+
+  //Spoke 512 points east, one pixel per bin.
+  for (uint32_t i = 0; i < sample.size(); i++) {
+    uint8_t const *pixel = reinterpret_cast<uint8_t*>(shmArgb_0->data()) + table.spoke(512)[i];
+    uint8_t inverted = (sample[i] == 0) ? 255 : ((sample[i] == 255) ? 0 : sample[i]);
+    REQUIRE(pixel[0] == inverted);
+    REQUIRE(pixel[1] == inverted);
+    REQUIRE(pixel[2] == sample[i]);
+    REQUIRE(pixel[3] == 0);
+  }
+}
+
+
+/////// Tests for the zero-copy decode path ///////
+
+TEST_CASE("Test 16 - decoder does not allocate per spoke.") {
+  std::cout << "Test Case 16 (Nominal Case). A full sweep is decoded from byte views without heap allocations." << std::endl; 
+  //Expected outcome is zero allocations after the first spoke.
+
+  uint16_t origin = 512; 
+  uint16_t c_height = 1024;
+  uint16_t c_width = 1024;
+  ScanTable table{origin, c_width, c_height};
+  Palette const palette = defaultPalette();
+
+  std::unique_ptr<cluon::SharedMemory> shmArgb_0{
+    new cluon::SharedMemory{"/Test_16.argb", uint32_t(c_width) * c_height * 4}};
+
+  std::vector<uint8_t> sample(512);
+  for (uint32_t i = 0; i < sample.size(); i++) sample[i] = uint8_t(i * 7);
+
+  SpokeView spoke;
+  spoke.data = sample.data();
+  spoke.length = uint32_t(sample.size());
+  spoke.azimuth = 2;
+  spoke.range = 1500;
+
+  //Warm up: the first spoke selects the scatter kernel.
+  SpokeCommit commit;
+  REQUIRE(decode(spoke, shmArgb_0, table, palette, false, origin, c_height, c_width, commit) == 2);
+
+  uint64_t const before = allocations.load();
+  int failures = 0;
+  for (uint32_t azimuth = 2; azimuth < 4096; azimuth += 2) {
+    spoke.azimuth = float(azimuth);
+    if (decode(spoke, shmArgb_0, table, palette, false, origin, c_height, c_width, commit) != int(azimuth)) failures++;
+  }
+  uint64_t const spokeAllocations = allocations.load() - before;
+
+  std::cout << "Test Case 16. Expected: 0 allocations" << ". Outcome: " << spokeAllocations << std::endl;
+  std::cout << std::endl;
+  REQUIRE(failures == 0);
+  REQUIRE(spokeAllocations == 0);
+}
+
+TEST_CASE("Test 17 - spoke extracted in place from a serialized message.") {
+  std::cout << "Test Case 17 (Nominal Case). A serialized RadarDetectionReading is read without copying its payload." << std::endl; 
+  //Expected outcome is the azimuth, range and payload of the message, pointing into the serialized data.
+
+  opendlv::proxy::RadarDetectionReading msg;
+  msg.azimuth(1024);
+  msg.range(1500);
+  msg.data(std::string{"Hello!"});
+
+  cluon::ToProtoVisitor protoEncoder;
+  msg.accept(protoEncoder);
+  std::string const serialized = protoEncoder.encodedData();
+
+  SpokeView spoke;
+  uint64_t const before = allocations.load();
+  bool const extracted = extractSpoke(serialized, spoke);
+  uint64_t const extractAllocations = allocations.load() - before;
+
+  REQUIRE(extracted);
+  REQUIRE(extractAllocations == 0);
+  REQUIRE(spoke.azimuth == Approx(1024));
+  REQUIRE(spoke.range == Approx(1500));
+  REQUIRE(std::string(reinterpret_cast<char const*>(spoke.data), spoke.length) == "Hello!");
+  REQUIRE(reinterpret_cast<char const*>(spoke.data) >= serialized.data());
+  REQUIRE(reinterpret_cast<char const*>(spoke.data) + spoke.length <= serialized.data() + serialized.size());
+
+  //A truncated message is rejected.
+  REQUIRE(!extractSpoke(serialized.substr(0, serialized.size() - 2), spoke));
+  std::cout << std::endl;
+}
+
+
+/////// Tests for the polar sweep buffer ///////
+
+TEST_CASE("Test 18 - decoder into the polar buffer.") {
+  std::cout << "Test Case 18 (Nominal Case). Spokes are stored by azimuth in the polar buffer and marked for rendering." << std::endl; 
+  //Expected outcome is msg.azimuth(), the strengths in the row of the spoke and one dirty spoke.
+
+  std::vector<uint8_t> sample{
+    0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+    0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+    0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92
+  };
+  SpokeView spoke;
+  spoke.data = sample.data();
+  spoke.length = uint32_t(sample.size());
+  spoke.azimuth = 1024;
+
+  PolarBuffer polar;
+  REQUIRE(polar.dirtyCount() == 0);
+
+  auto retVal = decode(spoke, polar, false);
+  std::cout << "Test Case 18. Expected: 1024" << ". Outcome: " << retVal << std::endl;
+  std::cout << std::endl;
+
+  REQUIRE(retVal == 1024);
+  REQUIRE(polar.dirtyCount() == 1);
+  REQUIRE(polar.dirty(512));
+  REQUIRE(polar.row(512)[0] == 0xe7);
+  REQUIRE(polar.row(512)[16] == 0x00);
+
+  //Same error codes as the Cartesian decoder.
+  spoke.azimuth = 5500;
+  REQUIRE(decode(spoke, polar, false) == -13);
+  spoke.length = 0;
+  REQUIRE(decode(spoke, polar, false) == -1);
+  REQUIRE(polar.dirtyCount() == 1);
+}
+
+TEST_CASE("Test 19 - lazy rendering from the polar buffer.") {
+  std::cout << "Test Case 19 (Nominal Case). Only dirty spokes are rendered, with the same pixels as the Cartesian decoder." << std::endl; 
+  //Expected outcome is one rendered spoke matching the direct decode, and nothing left to render.
+
+  std::vector<uint8_t> sample(512);
+  for (uint32_t i = 0; i < sample.size(); i++) sample[i] = uint8_t(i * 13);
+  SpokeView spoke;
+  spoke.data = sample.data();
+  spoke.length = uint32_t(sample.size());
+  spoke.azimuth = 700;
+
+  uint16_t origin = 512; 
+  uint16_t c_height = 1024;
+  uint16_t c_width = 1024;
+  ScanTable table{origin, c_width, c_height};
+  Palette const palette = defaultPalette();
+
+  std::unique_ptr<cluon::SharedMemory> shmArgb_0{
+    new cluon::SharedMemory{"/Test_19.argb", uint32_t(c_width) * c_height * 4}};
+  SpokeCommit commit;
+  REQUIRE(decode(spoke, shmArgb_0, table, palette, false, origin, c_height, c_width, commit) == 700);
+
+  PolarBuffer polar;
+  REQUIRE(decode(spoke, polar, false) == 700);
+
+  std::vector<char> canvas(table.canvasSize(), 0);
+  REQUIRE(renderDirty(polar, table, palette, canvas.data()) == 1);
+  REQUIRE(polar.dirtyCount() == 0);
+  REQUIRE(renderDirty(polar, table, palette, canvas.data()) == 0);
+
+  //Both draw every sample of the spoke, in the same order.
+  uint32_t const *offsets = table.spoke(350);
+  int mismatches = 0;
+  for (uint32_t i = 0; i < table.reach(); i++) {
+    if (std::memcmp(canvas.data() + offsets[i], shmArgb_0->data() + offsets[i], 4) != 0) mismatches++;
+  }
+  std::cout << "Test Case 19. Expected: 0 mismatches" << ". Outcome: " << mismatches << std::endl;
+  std::cout << std::endl;
+  REQUIRE(mismatches == 0);
+}
+
+
+/////// Tests for the inverse renderer ///////
+
+TEST_CASE("Test 20 - inverse renderer fills every pixel in range.") {
+  std::cout << "Test Case 20 (Nominal Case). The inverse renderer leaves no holes, unlike the forward renderer." << std::endl; 
+  //Expected outcome is no unwritten pixel in range for the inverse renderer, and some for the forward renderer.
+
+  uint16_t origin = 512; 
+  uint16_t c_height = 1024;
+  uint16_t c_width = 1024;
+  ScanTable table{origin, c_width, c_height};
+  InverseScanTable inverse{origin, c_width, c_height};
+  Palette const palette = defaultPalette();
+  ThreadPool pool{1};
+
+  //Every palette entry of the default palette is non zero, so an unwritten pixel stays zero.
+  PolarBuffer polar;
+  for (uint32_t spoke = 0; spoke < polar.spokes(); spoke++) {
+    for (uint32_t bin = 0; bin < polar.bins(); bin++) polar.row(spoke)[bin] = uint8_t(spoke + bin);
+  }
+
+  std::vector<char> forwardCanvas(table.canvasSize(), 0);
+  std::vector<char> inverseCanvas(table.canvasSize(), 0);
+  renderAll(polar, table, palette, forwardCanvas.data());
+  renderInverse(polar, inverse, palette, inverseCanvas.data(), pool);
+
+  auto holes = [&](std::vector<char> const &canvas) {
+    uint32_t count = 0;
+    for (uint32_t y = 0; y < c_height; y++) {
+      for (uint32_t x = 0; x < c_width; x++) {
+        double const dx = double(x) - origin;
+        double const dy = double(y) - origin;
+        uint32_t word;
+        std::memcpy(&word, canvas.data() + (x + y * c_width) * 4, 4);
+        if (std::sqrt(dx * dx + dy * dy) < 511 && word == 0) count++;
+      }
+    }
+    return count;
+  };
+
+  uint32_t const forwardHoles = holes(forwardCanvas);
+  uint32_t const inverseHoles = holes(inverseCanvas);
+  std::cout << "Test Case 20. Expected: 0 holes" << ". Outcome: " << inverseHoles << " (forward renderer: " << forwardHoles << ")" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(inverseHoles == 0);
+  REQUIRE(forwardHoles > 0);
+
+  //Along the axes both renderers read the same spoke and bin.
+  REQUIRE(std::memcmp(forwardCanvas.data() + (512 + 300 * 1024) * 4, inverseCanvas.data() + (512 + 300 * 1024) * 4, 4) == 0);
+  REQUIRE(std::memcmp(forwardCanvas.data() + (812 + 512 * 1024) * 4, inverseCanvas.data() + (812 + 512 * 1024) * 4, 4) == 0);
+}
+
+TEST_CASE("Test 21 - inverse renderer is independent of the thread count.") {
+  std::cout << "Test Case 21 (Nominal Case). Rows rendered in parallel give the same image as one thread." << std::endl; 
+  //Expected outcome is identical canvases.
+
+  InverseScanTable inverse{512, 1024, 1024};
+  Palette const palette = defaultPalette();
+
+  PolarBuffer polar;
+  for (uint32_t spoke = 0; spoke < polar.spokes(); spoke++) {
+    for (uint32_t bin = 0; bin < polar.bins(); bin++) polar.row(spoke)[bin] = uint8_t(spoke * 3 + bin);
+  }
+
+  ThreadPool single{1};
+  std::vector<char> expected(1024 * 1024 * 4, 0);
+  renderInverse(polar, inverse, palette, expected.data(), single);
+
+  for (uint32_t threads : {2u, 3u, 8u}) {
+    ThreadPool pool{threads};
+    std::vector<char> actual(1024 * 1024 * 4, 0);
+    renderInverse(polar, inverse, palette, actual.data(), pool);
+    renderInverse(polar, inverse, palette, actual.data(), pool);
+    REQUIRE(pool.threads() == threads);
+    REQUIRE(expected == actual);
+  }
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 22 - octant table matches per spoke trigonometry.") {
+  std::cout << "Test Case 22 (Nominal Case). Displacements derived by symmetry against sin and cos per spoke." << std::endl; 
+  //Expected outcome is a table under 1 MB whose displacements are at most one pixel off, and rarely so.
+
+  OctantTable octant;
+  uint32_t mismatches = 0;
+  int32_t worst = 0;
+  for (uint32_t spoke = 0; spoke < octant.spokes(); spoke++) {
+    double const angle_rad = (2 * M_PI * spoke) / octant.spokes();
+    for (uint32_t bin = 0; bin < octant.bins(); bin++) {
+      int32_t dx;
+      int32_t dy;
+      octant.displacement(spoke, bin, dx, dy);
+      int32_t const ex = std::abs(dx - int32_t(std::lround(std::sin(angle_rad) * bin)));
+      int32_t const ey = std::abs(dy - int32_t(std::lround(std::cos(angle_rad) * bin)));
+      if (ex || ey) mismatches++;
+      worst = std::max(worst, std::max(ex, ey));
+    }
+  }
+  std::cout << "Test Case 22. Expected: under 1048576 bytes" << ". Outcome: " << octant.size() << " bytes, " << mismatches << " rounding ties" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(octant.size() < 1024 * 1024);
+  REQUIRE(worst <= 1);
+  REQUIRE(mismatches < 64);
+
+  //Spoke counts that are not a multiple of 8 store every spoke.
+  OctantTable odd{2047, 512};
+  REQUIRE(odd.size() == 2047u * 512u * 4u);
+
+  //Expanded offsets follow the displacements.
+  ScanTable table{octant, 512, 1024, 1024};
+  REQUIRE(table.valid());
+  int32_t dx;
+  int32_t dy;
+  octant.displacement(700, 400, dx, dy);
+  REQUIRE(table.spoke(700)[400] == uint32_t((512 + dx) * 4 + (512 - dy) * 1024 * 4));
+}
+
+TEST_CASE("Test 23 - scan table shared between instances.") {
+  std::cout << "Test Case 23 (Nominal Case). A second instance with the same geometry maps the table built by the first." << std::endl; 
+  //Expected outcome is one builder, one attached instance with identical offsets, and a separate table for another geometry.
+
+  SharedScanTable first{400, 800, 800, 1024, 256};
+  SharedScanTable second{400, 800, 800, 1024, 256};
+  SharedScanTable other{300, 800, 800, 1024, 256};
+  ScanTable local{400, 800, 800, 1024, 256};
+
+  std::cout << "Test Case 23. Expected: built, attached" << ". Outcome: " << (first.attached() ? "attached" : "built") << ", " << (second.attached() ? "attached" : "built") << std::endl;
+  std::cout << std::endl;
+  REQUIRE(first.shared());
+  REQUIRE(!first.attached());
+  REQUIRE(second.attached());
+  REQUIRE(!other.attached());
+  REQUIRE(first.name() != other.name());
+
+  REQUIRE(second.table().valid());
+  REQUIRE(second.table().spoke(0) != first.table().spoke(0));
+  REQUIRE(std::memcmp(second.table().spoke(0), local.spoke(0), 1024u * 256u * 4u) == 0);
+  REQUIRE(std::memcmp(other.table().spoke(0), local.spoke(0), 1024u * 256u * 4u) != 0);
+
+  //A segment found while its creator is still building the table is waited for, not created again.
+  cluon::SharedMemory building{"/radar-scan-table-200-400x400-512x128", 64u + 512u * 128u * 4u};
+  REQUIRE(building.valid());
+  std::thread creator([&building]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    building.lock();
+    SharedScanTableHeader *header = new (building.data()) SharedScanTableHeader;
+    header->magic = 0x52534354;
+    header->origin = 200;
+    header->width = 400;
+    header->height = 400;
+    header->spokes = 512;
+    header->bins = 128;
+    header->reserved = 0;
+    ScanTable const built{OctantTable{512, 128}, 200, 400, 400, reinterpret_cast<uint32_t*>(building.data() + 64)};
+    header->ready.store(built.valid() ? 1 : 0, std::memory_order_release);
+    building.unlock();
+  });
+  SharedScanTable waiting{200, 400, 400, 512, 128};
+  creator.join();
+  ScanTable const expected{200, 400, 400, 512, 128};
+  REQUIRE(waiting.attached());
+  REQUIRE(std::memcmp(waiting.table().spoke(0), expected.spoke(0), 512u * 128u * 4u) == 0);
+
+  //A table with an offset outside the canvas is not mapped.
+  cluon::SharedMemory corrupt{"/radar-scan-table-100-200x200-256x64", 64u + 256u * 64u * 4u};
+  REQUIRE(corrupt.valid());
+  SharedScanTableHeader *header = new (corrupt.data()) SharedScanTableHeader;
+  header->magic = 0x52534354;
+  header->origin = 100;
+  header->width = 200;
+  header->height = 200;
+  header->spokes = 256;
+  header->bins = 64;
+  header->reserved = 0;
+  ScanTable const stale{OctantTable{256, 64}, 100, 200, 200, reinterpret_cast<uint32_t*>(corrupt.data() + 64)};
+  reinterpret_cast<uint32_t*>(corrupt.data() + 64)[1000] = 200u * 200u * 4u;
+  header->ready.store(stale.valid() ? 1 : 0, std::memory_order_release);
+  SharedScanTable rejected{100, 200, 200, 256, 64};
+  ScanTable const privateTable{100, 200, 200, 256, 64};
+  REQUIRE(!rejected.attached());
+  REQUIRE(!rejected.shared());
+  REQUIRE(std::memcmp(rejected.table().spoke(0), privateTable.spoke(0), 256u * 64u * 4u) == 0);
+
+  //A segment its creator never finished is built again.
+  cluon::SharedMemory abandoned{"/radar-scan-table-150-300x300-256x64", 64u + 256u * 64u * 4u};
+  REQUIRE(abandoned.valid());
+  SharedScanTable rebuilt{150, 300, 300, 256, 64};
+  REQUIRE(!rebuilt.attached());
+  REQUIRE(rebuilt.shared());
+  REQUIRE(rebuilt.table().valid());
+}
+
+TEST_CASE("Test 24 - spoke queue counters and overflow.") {
+  std::cout << "Test Case 24 (Nominal Case). A full queue drops new spokes and counts them." << std::endl; 
+  //Expected outcome is 8 slots, 2 drops, a high-water mark of 8 and the spokes out in order.
+
+  SpokeQueue queue{6, 16};
+  std::vector<uint8_t> bytes(32, 7);
+  SpokeView spoke;
+  spoke.data = bytes.data();
+  spoke.length = 16;
+  for (uint32_t i = 0; i < 10; i++) {
+    spoke.azimuth = float(i);
+    queue.push(spoke);
+  }
+  spoke.length = 17;
+  REQUIRE(!queue.push(spoke));
+
+  SpokeQueueStats stats = queue.stats();
+  std::cout << "Test Case 24. Expected: 3 drops" << ". Outcome: " << stats.drops << " drops" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(queue.capacity() == 8);
+  REQUIRE(stats.depth == 8);
+  REQUIRE(stats.highWater == 8);
+  REQUIRE(stats.pushed == 8);
+  REQUIRE(stats.drops == 3);
+
+  SpokeView out;
+  for (uint32_t i = 0; i < 8; i++) {
+    REQUIRE(queue.front(out));
+    REQUIRE(out.azimuth == Approx(float(i)));
+    REQUIRE(out.length == 16);
+    REQUIRE(out.data[15] == 7);
+    queue.pop();
+  }
+  REQUIRE(!queue.front(out));
+  REQUIRE(queue.stats().depth == 0);
+  REQUIRE(queue.stats().highWater == 8);
+}
+
+TEST_CASE("Test 25 - spoke queue between two threads.") {
+  std::cout << "Test Case 25 (Nominal Case). Spokes pushed by one thread arrive intact and in order on another." << std::endl; 
+  //Expected outcome is every pushed spoke received in order with its own bytes.
+
+  SpokeQueue queue{64, 512};
+  uint32_t const count = 20000;
+  std::thread producer([&queue, count]() {
+    std::vector<uint8_t> bytes(512);
+    for (uint32_t i = 0; i < count; i++) {
+      for (uint32_t j = 0; j < bytes.size(); j++) bytes[j] = uint8_t(i + j);
+      SpokeView spoke;
+      spoke.data = bytes.data();
+      spoke.length = 1 + i % 512;
+      spoke.azimuth = float(i);
+      while (!queue.push(spoke)) std::this_thread::yield();
+    }
+  });
+
+  uint32_t received = 0;
+  uint32_t corrupt = 0;
+  while (received < count) {
+    SpokeView spoke;
+    if (!queue.front(spoke)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (uint32_t(spoke.azimuth) != received || spoke.length != 1 + received % 512
+        || spoke.data[0] != uint8_t(received) || spoke.data[spoke.length - 1] != uint8_t(received + spoke.length - 1)) {
+      corrupt++;
+    }
+    queue.pop();
+    received++;
+  }
+  producer.join();
+
+  SpokeQueueStats const stats = queue.stats();
+  std::cout << "Test Case 25. Expected: 0 corrupt" << ". Outcome: " << corrupt << " corrupt, high-water " << stats.highWater << std::endl;
+  std::cout << std::endl;
+  REQUIRE(corrupt == 0);
+  REQUIRE(stats.pushed == count);
+  REQUIRE(stats.depth == 0);
+  REQUIRE(stats.highWater <= 64);
+}
+
+TEST_CASE("Test 26 - sector partition gives every pixel to one sector.") {
+  std::cout << "Test Case 26 (Nominal Case). Owned runs of all spokes cover the image with no pixel in two sectors." << std::endl; 
+  //Expected outcome is full coverage, no pixel written by two sectors and shared pixels only with several sectors.
+
+  ScanTable table{512, 1024, 1024};
+  SectorPartition single{table, 1};
+  SectorPartition partition{table, 4};
+
+  std::vector<uint8_t> covered(1024 * 1024, 0);
+  std::vector<int16_t> sectorOf(1024 * 1024, -1);
+  uint32_t conflicts = 0;
+  for (uint32_t spoke = 0; spoke < table.spokes(); spoke++) {
+    for (uint32_t bin = 0; bin < table.bins(); bin++) covered[table.spoke(spoke)[bin] / 4] = 1;
+    int16_t const sector = int16_t(partition.sector(spoke));
+    for (uint32_t r = 0; r < partition.runCount(spoke); r++) {
+      for (uint32_t bin = partition.runs(spoke)[2 * r]; bin < partition.runs(spoke)[2 * r + 1]; bin++) {
+        uint32_t const pixel = table.spoke(spoke)[bin] / 4;
+        if (sectorOf[pixel] >= 0 && sectorOf[pixel] != sector) conflicts++;
+        sectorOf[pixel] = sector;
+      }
+    }
+  }
+  uint32_t uncovered = 0;
+  for (uint32_t pixel = 0; pixel < covered.size(); pixel++) {
+    if (covered[pixel] && sectorOf[pixel] < 0) uncovered++;
+  }
+
+  std::cout << "Test Case 26. Expected: 0 conflicts, 0 uncovered" << ". Outcome: " << conflicts << " conflicts, " << uncovered << " uncovered, " << partition.sharedPixels() << " shared" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(conflicts == 0);
+  REQUIRE(uncovered == 0);
+  REQUIRE(single.sharedPixels() == 0);
+  REQUIRE(single.runCount(100) == 1);
+  REQUIRE(partition.sharedPixels() > 0);
+  REQUIRE(partition.sector(0) == 0);
+  REQUIRE(partition.sector(2047) == 3);
+}
+
+TEST_CASE("Test 27 - sector decoders match a serial render.") {
+  std::cout << "Test Case 27 (Nominal Case). A sweep decoded by sector workers gives the image of a serial decode and render." << std::endl; 
+  //Expected outcome is identical polar rows and canvases.
+
+  ScanTable table{512, 1024, 1024};
+  Palette const palette = defaultPalette();
+
+  //Spokes in index order, starting with azimuth 4096 for spoke 0, as a full render draws them.
+  std::vector<std::string> payloads;
+  for (uint32_t spoke = 0; spoke < 2048; spoke++) {
+    std::string payload(512, '\0');
+    for (uint32_t i = 0; i < payload.size(); i++) payload[i] = static_cast<char>((i * 5 + spoke * 6) & 0xff);
+    payloads.push_back(payload);
+  }
+  auto view = [&payloads](uint32_t i) {
+    SpokeView spoke;
+    spoke.data = reinterpret_cast<uint8_t const*>(payloads[i].data());
+    spoke.length = uint32_t(payloads[i].size());
+    spoke.azimuth = float((i == 0) ? 4096 : 2 * i);
+    return spoke;
+  };
+
+  PolarBuffer serial;
+  std::vector<char> expected(1024 * 1024 * 4, 0);
+  for (uint32_t i = 0; i < payloads.size(); i++) decode(view(i), serial, false);
+  renderAll(serial, table, palette, expected.data());
+
+  for (uint32_t workers : {1u, 3u}) {
+    PolarBuffer polar;
+    std::vector<char> canvas(1024 * 1024 * 4, 0);
+    {
+      SectorDecoder decoder{table, std::make_shared<Palette const>(palette), polar, canvas.data(), workers, 64};
+      REQUIRE(decoder.workers() == workers);
+      for (uint32_t i = 0; i < payloads.size(); i++) {
+        while (decoder.push(view(i)) == -14) std::this_thread::yield();
+      }
+      decoder.drain();
+    }
+    std::cout << "Test Case 27. Expected: identical image" << ". Outcome with " << workers << " workers: " << ((canvas == expected) ? "identical" : "different") << std::endl;
+    REQUIRE(std::memcmp(polar.data(), serial.data(), 2048u * 512u) == 0);
+    REQUIRE((canvas == expected));
+  }
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 28 - published frames are whole and in order.") {
+  std::cout << "Test Case 28 (Nominal Case). Frames published while a reader copies them are never torn." << std::endl; 
+  //Expected outcome is the latest frame with its number and time, and only uniform frames seen by the reader.
+
+  FramePublisher frames{"/test.frames", 64, 64, 3};
+  REQUIRE(frames.valid());
+  REQUIRE(frames.buffers() == 3);
+  std::vector<char> image(frames.frameBytes(), 0);
+  std::vector<char> copy(frames.frameBytes(), 0);
+  uint64_t sequence = 0;
+  int64_t timestamp = 0;
+  REQUIRE(!readLatestFrame(frames.segment(), copy.data(), sequence, timestamp));
+
+  for (uint32_t i = 1; i <= 5; i++) {
+    std::fill(image.begin(), image.end(), char(i));
+    REQUIRE(frames.publish(image.data(), 1000 * i) == i);
+  }
+  REQUIRE(readLatestFrame(frames.segment(), copy.data(), sequence, timestamp));
+  REQUIRE(sequence == 5);
+  REQUIRE(timestamp == 5000);
+  REQUIRE(copy == image);
+  REQUIRE(std::memcmp(frames.front(), image.data(), image.size()) == 0);
+
+  //Every frame is filled with its own number, so a torn copy holds two values.
+  std::atomic<bool> writing{true};
+  std::thread writer([&frames, &writing]() {
+    std::vector<char> frame(frames.frameBytes());
+    for (uint32_t i = 6; i < 20000; i++) {
+      std::fill(frame.begin(), frame.end(), char(i & 0x7f));
+      frames.publish(frame.data(), i);
+    }
+    writing = false;
+  });
+  uint32_t reads = 0;
+  uint32_t torn = 0;
+  uint64_t last = 0;
+  uint32_t backwards = 0;
+  while (writing) {
+    if (!readLatestFrame(frames.segment(), copy.data(), sequence, timestamp)) continue;
+    reads++;
+    if (std::count(copy.begin(), copy.end(), char(sequence & 0x7f)) != long(copy.size())) torn++;
+    if (sequence < last) backwards++;
+    last = sequence;
+  }
+  writer.join();
+  std::cout << "Test Case 28. Expected: 0 torn" << ". Outcome: " << torn << " torn in " << reads << " reads" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(torn == 0);
+  REQUIRE(backwards == 0);
+}
+
+TEST_CASE("Test 29 - seqlock status under one writer and several readers.") {
+  std::cout << "Test Case 29 (Stress Case). Readers polling the status and frames while the writer updates them." << std::endl; 
+  //Expected outcome is no inconsistent status, no torn frame and nothing going backwards in any reader.
+
+  FramePublisher frames{"/test-stress.frames", 32, 32, 3};
+  RadarFrameReader attached{"/test-stress.frames"};
+  REQUIRE(attached.valid());
+  REQUIRE(attached.width() == 32);
+  REQUIRE(attached.frameBytes() == 32u * 32u * 4u);
+
+  //Every field is derived from one counter, so a status mixed from two updates does not add up.
+  auto statusOf = [](uint64_t k) {
+    RadarFrameStatus status;
+    status.sweep = k;
+    status.sweepTimestamp = int64_t(3 * k);
+    status.lastAzimuth = float(k % 4096);
+    status.dirtyBegin = uint16_t(k % 2048);
+    status.dirtyEnd = uint16_t((k + 7) % 2048);
+    return status;
+  };
+
+  std::atomic<bool> writing{true};
+  std::thread writer([&frames, &writing, &statusOf]() {
+    std::vector<char> frame(frames.frameBytes());
+    for (uint64_t k = 1; k < 200000; k++) {
+      if (k % 16 == 0) {
+        std::fill(frame.begin(), frame.end(), char(k & 0x7f));
+        frames.publish(frame.data(), int64_t(k), statusOf(k));
+      } else {
+        frames.updateStatus(statusOf(k));
+      }
+      //Lets the readers in often, also on a single core.
+      if (k % 512 == 0) std::this_thread::yield();
+    }
+    writing = false;
+  });
+
+  std::atomic<uint32_t> errors{0};
+  std::atomic<uint32_t> statusReads{0};
+  std::atomic<uint32_t> frameReads{0};
+  std::vector<std::thread> readers;
+  for (uint32_t r = 0; r < 3; r++) {
+    readers.emplace_back([&frames, &writing, &errors, &statusReads, &frameReads, &statusOf]() {
+      RadarFrameReader reader{reinterpret_cast<RadarFrameHeader const*>(frames.segment())};
+      std::vector<char> image(reader.frameBytes());
+      uint64_t lastSweep = 0;
+      while (writing) {
+        RadarFrameStatus status;
+        bool const fresh = reader.poll(status);
+        if (!reader.status(status)) continue;
+        statusReads++;
+        RadarFrameStatus const expected = statusOf(status.sweep);
+        if (status.sweep > 0 && (status.sweepTimestamp != expected.sweepTimestamp || status.dirtyBegin != expected.dirtyBegin
+            || status.dirtyEnd != expected.dirtyEnd || uint64_t(status.lastAzimuth) != uint64_t(expected.lastAzimuth))) errors++;
+        if (status.sweep < lastSweep) errors++;
+        lastSweep = status.sweep;
+        if (fresh) {
+          uint64_t const previous = reader.lastFrame();
+          if (!reader.read(image.data())) continue;
+          frameReads++;
+          if (reader.lastFrame() < previous) errors++;
+          char const fill = char((reader.lastTimestamp()) & 0x7f);
+          if (std::count(image.begin(), image.end(), fill) != long(image.size())) errors++;
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) reader.join();
+
+  RadarFrameStatus last;
+  REQUIRE(attached.status(last));
+  std::cout << "Test Case 29. Expected: 0 errors" << ". Outcome: " << errors << " errors in " << statusReads << " status and " << frameReads << " frame reads" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(errors == 0);
+  REQUIRE(frameReads > 0);
+  REQUIRE(last.sweep == 199999);
+  REQUIRE(last.frame == 199999 / 16);
+}
+
+TEST_CASE("Test 30 - dirty region covers every changed pixel.") {
+  std::cout << "Test Case 30 (Nominal Case). Rectangles of the spokes written since the last push hold every changed pixel." << std::endl; 
+  //Expected outcome is no changed pixel outside the rectangles, for both renderers, and under a tenth of the image
+  //for the sector.
+
+  ScanTable table{512, 1024, 1024};
+  InverseScanTable inverse{512, 1024, 1024};
+  SpokeBounds bounds{table};
+  Palette const palette = defaultPalette();
+  ThreadPool pool{1};
+
+  //North points up from the origin.
+  REQUIRE(bounds.bounds(0).x == 511);
+  REQUIRE(bounds.bounds(0).width == 3);
+  REQUIRE(bounds.bounds(0).y == 0);
+  REQUIRE(bounds.bounds(0).height == 514);
+
+  PolarBuffer polar;
+  std::vector<char> forward(1024 * 1024 * 4, 0);
+  std::vector<char> gathered(1024 * 1024 * 4, 0);
+  renderAll(polar, table, palette, forward.data());
+  renderInverse(polar, inverse, palette, gathered.data(), pool);
+  std::vector<char> forwardBefore = forward;
+  std::vector<char> gatheredBefore = gathered;
+
+  //One display interval of 85 spokes that wraps past north, and one stray spoke.
+  DirtyRegion region{bounds};
+  std::vector<uint32_t> written;
+  for (uint32_t i = 0; i < 85; i++) written.push_back((2000 + i) % 2048);
+  written.push_back(700);
+  for (uint32_t spoke : written) {
+    for (uint32_t bin = 0; bin < polar.bins(); bin++) polar.row(spoke)[bin] = uint8_t(1 + (spoke + bin) % 200);
+    polar.markDirty(spoke);
+    region.add(spoke);
+  }
+  renderDirty(polar, table, palette, forward.data());
+  renderInverse(polar, inverse, palette, gathered.data(), pool);
+
+  auto outside = [&region](std::vector<char> const &before, std::vector<char> const &after) {
+    uint32_t count = 0;
+    for (uint32_t y = 0; y < 1024; y++) {
+      for (uint32_t x = 0; x < 1024; x++) {
+        if (std::memcmp(before.data() + (y * 1024 + x) * 4, after.data() + (y * 1024 + x) * 4, 4) == 0) continue;
+        bool inside = false;
+        for (Rect const &r : region.rects()) {
+          inside = inside || (x >= r.x && x < uint32_t(r.x) + r.width && y >= r.y && y < uint32_t(r.y) + r.height);
+        }
+        if (!inside) count++;
+      }
+    }
+    return count;
+  };
+  uint32_t const forwardOutside = outside(forwardBefore, forward);
+  uint32_t const gatheredOutside = outside(gatheredBefore, gathered);
+
+  std::cout << "Test Case 30. Expected: 0 outside" << ". Outcome: " << forwardOutside << " forward, " << gatheredOutside << " inverse outside " << region.rects().size() << " rectangles of " << region.area() << " pixels" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(forwardOutside == 0);
+  REQUIRE(gatheredOutside == 0);
+  REQUIRE(region.rects().size() == 2);
+  REQUIRE(uint64_t(region.rects()[0].width) * region.rects()[0].height * 10 < 1024u * 1024u);
+
+  //Merging keeps the rectangle count bounded.
+  DirtyRegion small{bounds, 3};
+  for (uint32_t spoke = 0; spoke < 2048; spoke += 100) small.add(spoke);
+  REQUIRE(small.rects().size() == 3);
+  small.clear();
+  REQUIRE(small.empty());
+}
+
+#ifdef HAVE_X11
+TEST_CASE("Test 31 - X11 display backends.") {
+  std::cout << "Test Case 31 (Nominal Case). The display picks MIT-SHM when it can, falls back to XPutImage, and is disabled without an X server." << std::endl; 
+  //Expected outcome is a disabled display that ignores pushes when DISPLAY is not set, and otherwise a working
+  //backend for both settings. Run under Xvfb to cover the X11 paths.
+
+  cluon::SharedMemory image{"/test31.argb", 1024 * 1024 * 4};
+  REQUIRE(image.valid());
+  for (uint32_t i = 0; i < 1024 * 1024; i++) reinterpret_cast<uint32_t *>(image.data())[i] = 0xff000000u | (i & 0xffffffu);
+
+  char const *name = std::getenv("DISPLAY");
+  bool const haveDisplay = (name != nullptr) && (name[0] != '\0');
+  X11Display shared{image, 1024, 1024, true};
+  X11Display put{image, 1024, 1024, false};
+
+  std::cout << "Test Case 31. Expected: " << (haveDisplay ? "xshm or fallback, xputimage" : "none, none") << ". Outcome: " << backendName(shared.backend()) << ", " << backendName(put.backend()) << std::endl;
+  std::cout << std::endl;
+  if (!haveDisplay) {
+    REQUIRE_FALSE(shared.valid());
+    REQUIRE_FALSE(put.valid());
+    shared.show();
+    put.show(std::vector<Rect>{Rect{0, 0, 16, 16}});
+    return;
+  }
+  REQUIRE(shared.valid());
+  REQUIRE(put.backend() == X11Backend::Put);
+  for (X11Display *d : {&shared, &put}) {
+    d->show();
+    d->show(std::vector<Rect>{Rect{0, 0, 16, 16}, Rect{500, 100, 24, 400}});
+  }
+}
+#endif
+
+TEST_CASE("Test 32 - frame mailbox keeps the newest state and pacing counts frames.") {
+  std::cout << "Test Case 32 (Nominal Case). Posts the render thread misses are merged into the next take." << std::endl; 
+  //Expected outcome is one ticket spanning every spoke posted since the last take, a sweep wakeup from another
+  //thread, and pacing statistics matching the synthetic frame times.
+
+  FrameMailbox mailbox;
+  FrameTicket ticket;
+  REQUIRE_FALSE(mailbox.take(ticket));
+
+  RadarFrameStatus status;
+  for (uint32_t spoke = 2040; spoke < 2048 + 10; spoke++) {
+    status.lastAzimuth = float(spoke % 2048 * 2);
+    mailbox.post(status, spoke % 2048, spoke == 2048);
+  }
+  REQUIRE(mailbox.take(ticket));
+  REQUIRE(ticket.firstSpoke == 2040);
+  REQUIRE(ticket.lastSpoke == 9);
+  REQUIRE(ticket.spokes == 18);
+  REQUIRE(ticket.sweepComplete);
+  REQUIRE(uint32_t(ticket.status.lastAzimuth) == 18);
+  REQUIRE_FALSE(mailbox.take(ticket));
+
+  //A waiting reader is woken by the spoke that completes a sweep, and not by the others.
+  REQUIRE_FALSE(mailbox.waitSweep(std::chrono::milliseconds(1)));
+  std::thread writer([&mailbox, &status]() {
+    for (uint32_t spoke = 0; spoke < 100; spoke++) mailbox.post(status, spoke, spoke == 99);
+  });
+  bool const woken = mailbox.waitSweep(std::chrono::milliseconds(5000));
+  writer.join();
+  REQUIRE(woken);
+  REQUIRE(mailbox.take(ticket));
+  REQUIRE(ticket.sweepComplete);
+
+  mailbox.close();
+  REQUIRE_FALSE(mailbox.waitSweep(std::chrono::milliseconds(5000)));
+
+  //Frames due every 40 ms; the third starts 30 ms late.
+  FramePacing pacing{std::chrono::milliseconds(40)};
+  auto const t0 = std::chrono::steady_clock::now();
+  auto at = [t0](int ms) { return t0 + std::chrono::milliseconds(ms); };
+  pacing.frame(at(0), at(0), at(5));
+  pacing.frame(at(40), at(40), at(45));
+  pacing.frame(at(80), at(110), at(125));
+  pacing.idle();
+  FramePacingStats const stats = pacing.stats();
+
+  std::cout << "Test Case 32. Expected: 3 frames, 1 late, 55 ms mean interval. Outcome: " << stats.frames << " frames, " << stats.late << " late, " << stats.meanInterval << " ms mean interval" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(stats.frames == 3);
+  REQUIRE(stats.idle == 1);
+  REQUIRE(stats.late == 1);
+  REQUIRE(std::fabs(stats.meanInterval - 55.0) < 1e-6);
+  REQUIRE(std::fabs(stats.jitter - 15.0) < 1e-6);
+  REQUIRE(std::fabs(stats.maxInterval - 70.0) < 1e-6);
+  REQUIRE(std::fabs(stats.meanRender - 25.0 / 3) < 1e-6);
+  REQUIRE(std::fabs(stats.maxRender - 15.0) < 1e-6);
+  pacing.reset();
+  REQUIRE(pacing.stats().frames == 0);
+}
+
+TEST_CASE("Test 33 - sweep assembler finds each revolution once.") {
+  std::cout << "Test Case 33 (Nominal Case). Sweeps end once per pass of north, through dropped spokes, jitter and stray azimuths." << std::endl; 
+  //Expected outcome is one sweep event per revolution at 24 rpm, with the dropped spokes listed as gaps, and no event
+  //from stray zero azimuths or spokes arriving out of order around north.
+
+  SweepAssembler assembler{2048};
+  std::vector<SweepInfo> completed;
+  int64_t time = 0;
+  //2.5 s per revolution.
+  int64_t const spokeTime = 2500000 / 2048;
+  auto feed = [&](uint32_t spoke) {
+    time += spokeTime;
+    if (assembler.add(spoke, time)) completed.push_back(assembler.last());
+  };
+
+  //Start half way round, then three revolutions.
+  for (uint32_t spoke = 1024; spoke < 2048; spoke++) feed(spoke);
+  for (uint32_t revolution = 0; revolution < 3; revolution++) {
+    for (uint32_t spoke = 0; spoke < 2048; spoke++) {
+      //Dropped spokes in the second revolution.
+      if (revolution == 1 && ((spoke >= 100 && spoke < 110) || spoke == 1500)) continue;
+      //Stray zero azimuths from dropped packets.
+      if (spoke == 700 || spoke == 1900) feed(0);
+      //Jitter around north: 2047 arrives after 0 and 1.
+      if (revolution == 2 && spoke == 2047) continue;
+      feed(spoke);
+      if (revolution == 2 && spoke == 2046) {
+        feed(0);
+        feed(1);
+        feed(2047);
+      }
+    }
+  }
+  feed(0);
+
+  std::cout << "Test Case 33. Expected: 4 sweeps, 11 missing. Outcome: " << completed.size() << " sweeps, " << (completed.size() > 2 ? completed[2].missing : 0) << " missing" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(completed.size() == 4);
+  REQUIRE(completed[0].partial);
+  REQUIRE(completed[0].received == 1024);
+  REQUIRE(completed[0].rpm == 0.0f);
+
+  SweepInfo const &whole = completed[1];
+  REQUIRE_FALSE(whole.partial);
+  REQUIRE(whole.received == 2048);
+  REQUIRE(whole.missing == 0);
+  REQUIRE(whole.gaps.empty());
+  REQUIRE(whole.rejected == 2);
+  REQUIRE(std::fabs(whole.rpm - 24.0f) < 0.1f);
+
+  SweepInfo const &dropped = completed[2];
+  REQUIRE(dropped.missing == 11);
+  REQUIRE(dropped.gapCount == 2);
+  REQUIRE(dropped.gaps[0].first == 100);
+  REQUIRE(dropped.gaps[0].count == 10);
+  REQUIRE(dropped.gaps[1].first == 1500);
+  REQUIRE(dropped.gaps[1].count == 1);
+
+  //The revolution whose last spoke arrived after north misses it, and the next sweep counts it as late.
+  REQUIRE(completed[3].missing == 1);
+  REQUIRE(completed[3].late == 0);
+  REQUIRE(assembler.sweeps() == 4);
+
+  //A confirmed jump past north, as after an outage, ends the sweep and starts a partial one.
+  for (uint32_t spoke = 2; spoke < 1000; spoke++) feed(spoke);
+  for (uint32_t spoke = 500; spoke < 510; spoke++) feed(spoke);
+  REQUIRE(completed.size() == 5);
+  REQUIRE(completed[4].partial == false);
+  //2047 and the 0 fed again after 1.
+  REQUIRE(completed[4].late == 2);
+  REQUIRE(completed[4].missing == 2048 - 1000);
+  for (uint32_t spoke = 510; spoke < 2048; spoke++) feed(spoke);
+  feed(0);
+  REQUIRE(completed.size() == 6);
+  REQUIRE(completed[5].partial);
+
+  //Spokes missing on both sides of north make one gap.
+  SweepAssembler small{64, 16, 1, 8};
+  for (uint32_t spoke = 0; spoke < 64; spoke++) small.add(spoke, 0);
+  for (uint32_t spoke = 2; spoke < 62; spoke++) small.add(spoke, 0);
+  REQUIRE(small.add(3, 0));
+  REQUIRE(small.last().missing == 4);
+  REQUIRE(small.last().gapCount == 1);
+  REQUIRE(small.last().gaps[0].first == 62);
+  REQUIRE(small.last().gaps[0].count == 4);
+}
+
+TEST_CASE("Test 34 - palette presets, gain and gamma.") {
+  std::cout << "Test Case 34 (Nominal Case). Presets build 32-bit palettes and are switched while a renderer holds the old one." << std::endl; 
+  //Expected outcome is the classic preset equal to the default palette, the gain and gamma applied to the strengths,
+  //and a renderer keeping a whole palette across a switch.
+
+  Palette const classic = makePalette(PalettePreset::Classic);
+  Palette const original = defaultPalette();
+  REQUIRE(std::memcmp(classic.argb, original.argb, sizeof(classic.argb)) == 0);
+
+  Palette const grey = makePalette(PalettePreset::Greyscale);
+  REQUIRE(grey.argb[0] == paletteEntry(0, 0, 0, 0));
+  REQUIRE(grey.argb[100] == paletteEntry(100, 100, 100, 0));
+
+  //Gain doubles the level and clamps; gamma 2 squares it; strength 0 stays background.
+  Palette const doubled = makePalette(PalettePreset::Greyscale, 2.0f);
+  REQUIRE(doubled.argb[0] == paletteEntry(0, 0, 0, 0));
+  REQUIRE(doubled.argb[60] == paletteEntry(120, 120, 120, 0));
+  REQUIRE(doubled.argb[200] == paletteEntry(255, 255, 255, 0));
+  Palette const squared = makePalette(PalettePreset::Greyscale, 1.0f, 2.0f);
+  REQUIRE(squared.argb[255] == paletteEntry(255, 255, 255, 0));
+  REQUIRE(squared.argb[128] == paletteEntry(64, 64, 64, 0));
+
+  Palette const night = makePalette(PalettePreset::Night);
+  REQUIRE(night.argb[255] == paletteEntry(0, 0, 127, 0));
+  Palette const day = makePalette(PalettePreset::Day);
+  REQUIRE(day.argb[0] == paletteEntry(235, 235, 235, 0));
+
+  PalettePreset preset = PalettePreset::Classic;
+  for (uint32_t i = 0; i < PALETTE_PRESETS; i++) {
+    REQUIRE(parsePreset(presetName(PalettePreset(i)), preset));
+    REQUIRE(preset == PalettePreset(i));
+  }
+  REQUIRE_FALSE(parsePreset("sepia", preset));
+
+  PaletteSettings settings;
+  REQUIRE(adjustPalette(settings, 'p'));
+  REQUIRE(settings.preset == PalettePreset::Greyscale);
+  REQUIRE(adjustPalette(settings, '+'));
+  REQUIRE(std::fabs(settings.gain - 1.25f) < 1e-6f);
+  REQUIRE(adjustPalette(settings, '0'));
+  REQUIRE(std::fabs(settings.gain - 1.0f) < 1e-6f);
+  REQUIRE_FALSE(adjustPalette(settings, 'x'));
+  for (uint32_t i = 0; i < PALETTE_PRESETS - 1; i++) adjustPalette(settings, 'p');
+  REQUIRE(settings.preset == PalettePreset::Classic);
+
+  //A renderer that took the palette before a switch keeps it, however many switches follow.
+  ActivePalette active{classic};
+  std::shared_ptr<Palette const> const held = active.current();
+  uint32_t const version = active.version();
+  active.set(grey);
+  active.set(makePalette(PalettePreset::Night));
+  active.set(grey);
+  REQUIRE(active.version() == version + 3);
+  REQUIRE(std::memcmp(held->argb, classic.argb, sizeof(classic.argb)) == 0);
+  REQUIRE(std::memcmp(active.current()->argb, grey.argb, sizeof(grey.argb)) == 0);
+
+  std::cout << "Test Case 34. Expected: classic matches default. Outcome: " << (std::memcmp(classic.argb, original.argb, sizeof(classic.argb)) == 0 ? "matches" : "differs") << std::endl;
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 35 - fan-in aggregation writes every pixel once.") {
+  std::cout << "Test Case 35 (Nominal Case). Samples sharing a pixel are combined with last, max or mean in one pass." << std::endl; 
+  //Expected outcome is every sample in a run or a shared pixel, one store per covered pixel, last equal to the plain
+  //forward render, and max and mean equal to a brute force over the table.
+
+  ScanTable table{512, 1024, 1024};
+  FanInTable fanIn{table};
+
+  uint64_t runBins = 0;
+  uint64_t sharedSamples = 0;
+  uint64_t covered = 0;
+  for (uint32_t spoke = 0; spoke < table.spokes(); spoke++) {
+    for (uint32_t i = 0; i < fanIn.runCount(spoke); i++) runBins += uint32_t(fanIn.runs(spoke)[2 * i + 1] - fanIn.runs(spoke)[2 * i]);
+  }
+  for (uint32_t pixel = 0; pixel < fanIn.sharedPixels(); pixel++) sharedSamples += fanIn.sourceCount(pixel);
+  for (uint32_t offset = 0; offset < table.canvasSize(); offset += 4) covered += (fanIn.fanIn(offset) > 0) ? 1 : 0;
+  REQUIRE(runBins + sharedSamples == uint64_t(table.spokes()) * table.bins());
+  REQUIRE(runBins + fanIn.sharedPixels() == covered);
+  REQUIRE(fanIn.fanIn(table.spoke(0)[0]) == fanIn.maxFanIn());
+  REQUIRE(fanIn.maxFanIn() >= table.spokes());
+
+  //Pseudo random strengths.
+  PolarBuffer polar;
+  uint32_t state = 7;
+  for (uint32_t spoke = 0; spoke < polar.spokes(); spoke++) {
+    for (uint32_t bin = 0; bin < polar.bins(); bin++) {
+      state = state * 1103515245u + 12345u;
+      polar.row(spoke)[bin] = uint8_t(state >> 24);
+    }
+  }
+  Palette const palette = makePalette(PalettePreset::Greyscale);
+
+  std::vector<char> plain(table.canvasSize(), 0);
+  std::vector<char> last(table.canvasSize(), 0);
+  renderAll(polar, table, palette, plain.data());
+  AggregateRenderer lastRenderer{table, Aggregation::Last};
+  lastRenderer.renderAll(polar, palette, last.data());
+  REQUIRE((plain == last));
+
+  //Brute force over every sample.
+  std::vector<uint32_t> maxima(table.canvasSize() / 4, 0);
+  std::vector<uint32_t> sums(table.canvasSize() / 4, 0);
+  for (uint32_t spoke = 0; spoke < table.spokes(); spoke++) {
+    for (uint32_t bin = 0; bin < table.bins(); bin++) {
+      uint32_t const pixel = table.spoke(spoke)[bin] / 4;
+      maxima[pixel] = std::max<uint32_t>(maxima[pixel], polar.row(spoke)[bin]);
+      sums[pixel] += polar.row(spoke)[bin];
+    }
+  }
+  AggregateRenderer maxRenderer{table, Aggregation::Max};
+  AggregateRenderer meanRenderer{table, Aggregation::Mean};
+  std::vector<char> maxCanvas(table.canvasSize(), 0);
+  std::vector<char> meanCanvas(table.canvasSize(), 0);
+  maxRenderer.renderAll(polar, palette, maxCanvas.data());
+  meanRenderer.renderAll(polar, palette, meanCanvas.data());
+  uint32_t maxErrors = 0;
+  uint32_t meanErrors = 0;
+  for (uint32_t pixel = 0; pixel < maxima.size(); pixel++) {
+    uint32_t const count = fanIn.fanIn(pixel * 4);
+    if (count == 0) continue;
+    if (std::memcmp(maxCanvas.data() + pixel * 4, &palette.argb[maxima[pixel]], 4) != 0) maxErrors++;
+    uint32_t const mean = (sums[pixel] + count / 2) / count;
+    if (std::memcmp(meanCanvas.data() + pixel * 4, &palette.argb[mean], 4) != 0) meanErrors++;
+  }
+
+  //A dirty spoke updates its shared pixels from all their samples, as a full render would.
+  for (uint32_t bin = 0; bin < polar.bins(); bin++) polar.row(5)[bin] = 255;
+  polar.markDirty(5);
+  REQUIRE(maxRenderer.renderDirty(polar, palette, maxCanvas.data()) == 1);
+  std::vector<char> full(table.canvasSize(), 0);
+  maxRenderer.renderAll(polar, palette, full.data());
+
+  std::cout << "Test Case 35. Expected: 0 errors. Outcome: " << maxErrors << " max, " << meanErrors << " mean errors, " << fanIn.sharedPixels() << " shared pixels, fan-in up to " << fanIn.maxFanIn() << std::endl;
+  std::cout << std::endl;
+  REQUIRE(maxErrors == 0);
+  REQUIRE(meanErrors == 0);
+  REQUIRE((maxCanvas == full));
+
+  Aggregation mode = Aggregation::Last;
+  REQUIRE(parseAggregation("max", mode));
+  REQUIRE(mode == Aggregation::Max);
+  REQUIRE_FALSE(parseAggregation("min", mode));
+}
+
+TEST_CASE("Test 36 - scan tables per range scale.") {
+  std::cout << "Test Case 36 (Nominal Case). Spokes of every range are drawn at the scale set by the first range." << std::endl; 
+  //Expected outcome is the unscaled table for the first range, half the distance for half the range, a table cut at
+  //the canvas edge for twice the range, and the least recently used range dropped once the cache is full.
+
+  ScanTable native{512, 1024, 1024};
+  ScanTableCache cache{512, 1024, 1024, 2048, 512, 0.0f, 2};
+
+  std::shared_ptr<RangeTables const> const first = cache.tables(1500);
+  REQUIRE(cache.metersPerPixel() > 2.9f);
+  REQUIRE(cache.metersPerPixel() < 3.0f);
+  REQUIRE(first->range() == 1500);
+  REQUIRE(first->table().valid());
+  REQUIRE(first->table().reach() == 512);
+  REQUIRE(std::memcmp(first->table().spoke(0), native.spoke(0), 2048u * 512u * 4u) == 0);
+
+  //Half the range: bin 200 lies 100 pixels north.
+  std::shared_ptr<RangeTables const> const half = cache.tables(750.2f);
+  REQUIRE(half->range() == 750);
+  REQUIRE(half->table().reach() == 512);
+  REQUIRE(half->table().spoke(0)[200] == (512 + 412 * 1024) * 4);
+  REQUIRE(half->table().spoke(512)[200] == (612 + 512 * 1024) * 4);
+
+  //Twice the range: the bins past 511 pixels are not drawn.
+  REQUIRE(cache.tables(1500) == first);
+  std::shared_ptr<RangeTables const> const twice = cache.tables(3000);
+  REQUIRE(twice->table().valid());
+  REQUIRE(twice->table().reach() == 256);
+  REQUIRE(twice->table().spoke(1024)[255] == (512 + 1022 * 1024) * 4);
+
+  //Rendering the cut table only writes within the canvas, and its bounds stay on the canvas.
+  PolarBuffer polar;
+  for (uint32_t spoke = 0; spoke < polar.spokes(); spoke++) {
+    for (uint32_t bin = 0; bin < polar.bins(); bin++) polar.row(spoke)[bin] = uint8_t(bin);
+  }
+  Palette const palette = makePalette(PalettePreset::Greyscale);
+  std::vector<char> canvas(twice->table().canvasSize(), 0);
+  REQUIRE(renderAll(polar, twice->table(), palette, canvas.data()) == 2048);
+  REQUIRE(std::memcmp(canvas.data() + (512 + 112 * 1024) * 4, &palette.argb[200], 4) == 0);
+  REQUIRE(twice->bounds().bounds(0).y == 1);
+
+  std::cout << "Test Case 36. Expected: 2 kept, 3 built, 1 hit" << ". Outcome: " << cache.size() << " kept, " << cache.builds() << " built, " << cache.hits() << " hit" << std::endl;
+  std::cout << std::endl;
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.builds() == 3);
+  REQUIRE(cache.hits() == 1);
+  //Using 1500 again leaves 3000 the least recently used, so it is the one dropped.
+  cache.tables(1500);
+  REQUIRE(cache.builds() == 3);
+  cache.tables(750);
+  REQUIRE(cache.builds() == 4);
+  //A dropped range stays usable for as long as it is held.
+  REQUIRE(twice->table().valid());
+  //A range under half a meter has no scale.
+  REQUIRE(cache.tables(0.3f) == nullptr);
+  REQUIRE(cache.builds() == 4);
+
+  //The first range reaches the nearest edge of the canvas, also with fewer bins than half the canvas.
+  ScanTableCache wide{512, 1536, 1024, 2048, 256, 0.0f, 1};
+  std::shared_ptr<RangeTables const> const spread = wide.tables(1024);
+  REQUIRE(wide.metersPerPixel() == Approx(2.0f));
+  REQUIRE(spread->table().pixelsPerBin() == Approx(2.0f));
+  REQUIRE(spread->table().reach() == 256);
+
+  //The inverse table gathers from the same bins.
+  InverseScanTable inverse{512, 1024, 1024, 2048, 512, 2.0f};
+  REQUIRE(inverse.row(112)[512] == 200u);
+  REQUIRE(inverse.row(0)[512] == 256u);
+  REQUIRE(inverse.rowBegin(512) == 0);
+}
+
+TEST_CASE("Test 37 - radars of one process share the tables and nothing else.") {
+  std::cout << "Test Case 37 (Nominal Case). Two radar channels draw their own polar buffers into their own images." << std::endl; 
+  //Expected outcome is one set of tables for both radars, a spoke of one radar only in its own image, and an empty
+  //sweep and a cleared image after a range switch.
+
+  std::vector<uint32_t> stamps;
+  REQUIRE(parseSenderStamps("1,2,30", stamps));
+  REQUIRE((stamps == std::vector<uint32_t>{1, 2, 30}));
+  REQUIRE_FALSE(parseSenderStamps("1,,2", stamps));
+  REQUIRE_FALSE(parseSenderStamps("1,1", stamps));
+  REQUIRE_FALSE(parseSenderStamps("radar", stamps));
+  REQUIRE_FALSE(parseSenderStamps("", stamps));
+  REQUIRE((stamps == std::vector<uint32_t>{1, 2, 30}));
+
+  ScanTable const table{512, 1024, 1024};
+  std::shared_ptr<RangeTables const> const tables{std::make_shared<RangeTables>(table, 0, false, Aggregation::Max)};
+  RadarChannel first{1, "/Test_37-1", 1024, 1024, 2, 64, 0, tables};
+  RadarChannel second{2, "/Test_37-2", 1024, 1024, 2, 64, 0, tables};
+  REQUIRE(first.image->valid());
+  REQUIRE(second.image->valid());
+  REQUIRE(first.tables == second.tables);
+  REQUIRE(first.aggregate);
+  REQUIRE(first.aggregate.get() != second.aggregate.get());
+  REQUIRE(&first.aggregate->fanIn() == tables->fanIn());
+
+  Palette const palette = makePalette(PalettePreset::Greyscale);
+  ThreadPool pool{1};
+  std::memset(first.image->data(), 0, first.image->size());
+  std::memset(second.image->data(), 0, second.image->size());
+  for (uint32_t bin = 0; bin < first.polar.bins(); bin++) first.polar.row(512)[bin] = 200;
+  first.polar.markDirty(512);
+  first.render(palette, false, pool);
+  second.render(palette, false, pool);
+  uint32_t const east = (612 + 512 * 1024) * 4;
+  REQUIRE(std::memcmp(first.image->data() + east, &palette.argb[200], 4) == 0);
+  REQUIRE(std::memcmp(second.image->data() + east, &palette.argb[200], 4) != 0);
+
+  //Another range: the spokes held are dropped and the image drawn again from the empty buffer.
+  ScanTableCache cache{512, 1024, 1024, 2048, 512, 1500.0f / 512, 2, false, Aggregation::Max};
+  first.switchRange(cache.tables(3000));
+  REQUIRE(first.rangeSwitches == 1);
+  REQUIRE(first.polar.dirtyCount() == first.polar.spokes());
+  REQUIRE(first.tables->table().reach() == 256);
+  first.render(palette, false, pool);
+  REQUIRE(first.rangeDrawn == 1);
+  REQUIRE(std::memcmp(first.image->data() + east, &palette.argb[0], 4) == 0);
+  REQUIRE(tables.use_count() == 2);
+
+  std::cout << "Test Case 37. Expected: shared tables" << ". Outcome: " << tables.use_count() << " users of the unscaled tables" << std::endl;
+  std::cout << std::endl;
+}
+
+static cluon::data::Envelope envelopeOf(int32_t dataType, std::string const &payload, int64_t microseconds) {
+  cluon::data::Envelope env;
+  env.dataType(dataType);
+  env.serializedData(payload);
+  env.sampleTimeStamp(cluon::time::fromMicroseconds(microseconds));
+  return env;
+}
+
+template <typename T>
+static std::string serialize(T &msg) {
+  cluon::ToProtoVisitor visitor;
+  msg.accept(visitor);
+  return visitor.encodedData();
+}
+
+TEST_CASE("Test 38 - navigation handlers only take their own messages.") {
+  NavigationState navigation;
+  float value{0};
+  int64_t sampled{0};
+  REQUIRE(!navigation.heading(value, sampled));
+  REQUIRE(!navigation.speed(value, sampled));
+
+  opendlv::proxy::GeodeticHeadingReading heading;
+  heading.northHeading(1.5f);
+  opendlv::proxy::GroundSpeedReading speed;
+  speed.groundSpeed(7.25f);
+  opendlv::proxy::RadarDetectionReading spoke;
+  spoke.azimuth(90.0f);
+
+  //Envelopes of another type are left alone, even with a payload that would parse.
+  navigation.onHeading(envelopeOf(opendlv::proxy::GroundSpeedReading::ID(), serialize(speed), 10));
+  navigation.onHeading(envelopeOf(opendlv::proxy::RadarDetectionReading::ID(), serialize(spoke), 10));
+  navigation.onSpeed(envelopeOf(opendlv::proxy::GeodeticHeadingReading::ID(), serialize(heading), 10));
+  REQUIRE(navigation.headings() == 0);
+  REQUIRE(navigation.speeds() == 0);
+
+  navigation.onHeading(envelopeOf(opendlv::proxy::GeodeticHeadingReading::ID(), serialize(heading), 1000));
+  navigation.onSpeed(envelopeOf(opendlv::proxy::GroundSpeedReading::ID(), serialize(speed), 2000));
+  REQUIRE(navigation.heading(value, sampled));
+  REQUIRE(std::fabs(value - 1.5f) < 1e-6f);
+  REQUIRE(sampled == 1000);
+  REQUIRE(navigation.speed(value, sampled));
+  REQUIRE(std::fabs(value - 7.25f) < 1e-6f);
+  REQUIRE(sampled == 2000);
+  REQUIRE(navigation.headings() == 1);
+  REQUIRE(navigation.speeds() == 1);
+
+  std::cout << "Test Case 38. Expected: heading 1.5, speed 7.25" << ". Outcome: heading " << heading.northHeading() << ", speed " << value << std::endl;
+  std::cout << std::endl;
+}
+
+static void pushAzimuths(SpokeQueue &queue, std::vector<float> const &azimuths) {
+  std::vector<uint8_t> bytes(8, 1);
+  SpokeView spoke;
+  spoke.data = bytes.data();
+  spoke.length = uint32_t(bytes.size());
+  for (float azimuth : azimuths) {
+    spoke.azimuth = azimuth;
+    queue.push(spoke);
+  }
+}
+
+static std::vector<float> drainAzimuths(SpokeQueue &queue, SpokeThrottle &throttle) {
+  std::vector<float> decoded;
+  SpokeView spoke;
+  while (throttle.next(queue, spoke)) {
+    decoded.push_back(spoke.azimuth);
+    queue.pop();
+  }
+  return decoded;
+}
+
+TEST_CASE("Test 39 - overload policies skip spokes predictably.") {
+  std::vector<float> sequence;
+  for (uint32_t i = 0; i < 16; i++) sequence.push_back(float(2 * i));
+
+  SpokeQueue queue{16, 8};
+  SpokeThrottle none{Overload::Off, 2048};
+  pushAzimuths(queue, sequence);
+  REQUIRE((drainAzimuths(queue, none) == sequence));
+  REQUIRE(none.stats().decoded == 16);
+
+  //Past half the queue the oldest spokes go, down to a quarter.
+  SpokeThrottle dropOldest{Overload::DropOldest, 2048};
+  pushAzimuths(queue, std::vector<float>(sequence.begin(), sequence.begin() + 12));
+  REQUIRE((drainAzimuths(queue, dropOldest) == std::vector<float>{16, 18, 20, 22}));
+  REQUIRE(dropOldest.stats().droppedOldest == 8);
+
+  //Only spokes with a newer one of the same azimuth waiting are skipped.
+  SpokeThrottle latest{Overload::LatestPerAzimuth, 2048};
+  pushAzimuths(queue, {8, 10, 12, 8, 10, 14});
+  REQUIRE((drainAzimuths(queue, latest) == std::vector<float>{12, 8, 10, 14}));
+  REQUIRE(latest.stats().coalesced == 2);
+
+  //Every other spoke while a quarter of the queue is waiting.
+  SpokeThrottle decimate{Overload::Decimate, 2048};
+  pushAzimuths(queue, std::vector<float>(sequence.begin(), sequence.begin() + 8));
+  REQUIRE((drainAzimuths(queue, decimate) == std::vector<float>{0, 4, 8, 10, 12, 14}));
+  REQUIRE(decimate.stats().decimated == 2);
+
+  //Auto drops the oldest from three quarters full and steps back down as the queue drains, through decimate only, as
+  //16 slots are shorter than a sweep.
+  SpokeThrottle automatic{Overload::Auto, 2048};
+  pushAzimuths(queue, std::vector<float>(sequence.begin(), sequence.begin() + 13));
+  REQUIRE((drainAzimuths(queue, automatic) == std::vector<float>{18, 20, 22, 24}));
+  OverloadStats const &stats = automatic.stats();
+  REQUIRE(stats.droppedOldest == 9);
+  REQUIRE(stats.active == Overload::Off);
+  REQUIRE(stats.modeChanges == 3);
+
+  Overload parsed{Overload::Off};
+  REQUIRE(parseOverload("latest", parsed));
+  REQUIRE(parsed == Overload::LatestPerAzimuth);
+  REQUIRE(!parseOverload("newest", parsed));
+  REQUIRE(std::string{overloadName(Overload::DropOldest)} == "drop-oldest");
+
+  std::cout << "Test Case 39. Expected: 8 dropped, 2 coalesced, 2 decimated" << ". Outcome: " << dropOldest.stats().droppedOldest << " dropped, " << latest.stats().coalesced << " coalesced, " << decimate.stats().decimated << " decimated" << std::endl;
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 40 - scan tables and channels for other radar and canvas geometries.") {
+  //A 4096 spoke, 1024 bin radar on a 2048 pixel canvas, expanded with the row stride as a constant, and on a canvas
+  //of another width, expanded with the stride taken at run time.
+  ScanTable fixed{1024, 2048, 2048, 4096, 1024};
+  ScanTable generic{1024, 2050, 2049, 4096, 1024};
+  REQUIRE(fixed.valid());
+  REQUIRE(generic.valid());
+
+  OctantTable const octant{4096, 1024};
+  uint32_t mismatches = 0;
+  for (uint32_t spoke = 0; spoke < 4096; spoke += 7) {
+    for (uint32_t bin = 0; bin < 1024; bin++) {
+      int32_t dx;
+      int32_t dy;
+      octant.displacement(spoke, bin, dx, dy);
+      if (fixed.spoke(spoke)[bin] != uint32_t(((1024 - dy) * 2048 + 1024 + dx) * 4)) mismatches++;
+      if (generic.spoke(spoke)[bin] != uint32_t(((1024 - dy) * 2050 + 1024 + dx) * 4)) mismatches++;
+    }
+  }
+  REQUIRE(mismatches == 0);
+
+  //Azimuths count 4096 steps per revolution whatever the number of spokes.
+  std::vector<uint8_t> bytes(1024, 9);
+  SpokeView spoke;
+  spoke.data = bytes.data();
+  spoke.length = uint32_t(bytes.size());
+  spoke.azimuth = 4095;
+  REQUIRE(spokeIndex(spoke, 4096, false) == 4095);
+  REQUIRE(spokeIndex(spoke, 2048, false) == 2047);
+
+  //The channel buffers the spokes and bins of its tables.
+  std::shared_ptr<RangeTables const> const tables{std::make_shared<RangeTables>(fixed, 0, false, Aggregation::Last)};
+  RadarChannel radar{1, "/Test_40", 2048, 2048, 2, 64, 0, tables};
+  REQUIRE(radar.polar.spokes() == 4096);
+  REQUIRE(radar.polar.bins() == 1024);
+  REQUIRE(radar.queue.maxLength() >= 1024);
+  REQUIRE(decode(spoke, radar.polar, false) == 4095);
+  REQUIRE(radar.polar.row(4095)[1023] == 9);
+
+  std::cout << "Test Case 40. Expected: 0 mismatches" << ". Outcome: " << mismatches << " mismatches" << std::endl;
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 41 - 4 bit samples unpack the same with every kernel.") {
+  uint8_t const pair = 0x21;
+  uint8_t two[2];
+  unpackScalar(&pair, 2, two, false);
+  REQUIRE(two[0] == 17);
+  REQUIRE(two[1] == 34);
+  unpackScalar(&pair, 2, two, true);
+  REQUIRE(two[0] == 34);
+  REQUIRE(two[1] == 17);
+
+  std::vector<uint8_t> packed(600);
+  for (uint32_t i = 0; i < packed.size(); i++) packed[i] = uint8_t(i * 37 + 11);
+  uint32_t mismatches = 0;
+  for (SampleFormat format : {SampleFormat::Nibble, SampleFormat::NibbleHighFirst}) {
+    for (uint32_t count : {0u, 1u, 31u, 33u, 63u, 64u, 65u, 1023u, 1200u}) {
+      std::vector<uint8_t> expected(count + 1, 0xAB);
+      unpackScalar(packed.data(), count, expected.data(), format == SampleFormat::NibbleHighFirst);
+      for (int level = 0; level <= int(detectKernelLevel()); level++) {
+        std::vector<uint8_t> samples(count + 1, 0xAB);
+        unpackKernel(format, KernelLevel(level))(packed.data(), count, samples.data());
+        if (samples != expected) mismatches++;
+      }
+    }
+  }
+  REQUIRE(mismatches == 0);
+  REQUIRE(unpackKernel(SampleFormat::Byte) == nullptr);
+
+  //8 bit spokes pass through; 4 bit ones give two bins a byte, into the same buffer every time, up to bins.
+  SpokeView spoke;
+  spoke.data = packed.data();
+  spoke.length = 512;
+  spoke.azimuth = 100;
+  SpokeUnpacker bytes{SampleFormat::Byte, 1024};
+  REQUIRE(bytes.unpack(spoke).data == packed.data());
+  REQUIRE(bytes.unpack(spoke).length == 512);
+  SpokeUnpacker nibbles{SampleFormat::Nibble, 1000};
+  SpokeView const first = nibbles.unpack(spoke);
+  REQUIRE(first.length == 1000);
+  REQUIRE(first.azimuth == Approx(100));
+  REQUIRE(first.data[1] == uint8_t((packed[0] >> 4) * 17));
+  spoke.length = 100;
+  SpokeView const second = nibbles.unpack(spoke);
+  REQUIRE(second.data == first.data);
+  REQUIRE(second.length == 200);
+
+  SampleFormat parsed{SampleFormat::Byte};
+  REQUIRE(parseSampleFormat("4bit-high", parsed));
+  REQUIRE(parsed == SampleFormat::NibbleHighFirst);
+  REQUIRE(!parseSampleFormat("12bit", parsed));
+
+  std::cout << "Test Case 41. Expected: 0 mismatches" << ". Outcome: " << mismatches << " mismatches up to " << kernelName(detectKernelLevel()) << std::endl;
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 42 - progress between frames keeps the dirty range of the latest frame.") {
+  FramePublisher frames{"/test-progress.frames", 16, 16, 2};
+  RadarFrameReader reader{"/test-progress.frames"};
+  REQUIRE(reader.valid());
+  std::vector<char> image(frames.frameBytes(), 1);
+
+  RadarFrameStatus status;
+  status.sweep = 3;
+  status.dirtyBegin = 100;
+  status.dirtyEnd = 180;
+  frames.publish(image.data(), 10, status);
+
+  //Spokes decoded after the frame move the azimuth on, not the range of the frame.
+  RadarFrameStatus progress;
+  progress.sweep = 3;
+  progress.lastAzimuth = 900;
+  progress.dirtyBegin = 7;
+  progress.dirtyEnd = 450;
+  frames.updateProgress(progress);
+
+  RadarFrameStatus read;
+  REQUIRE(reader.status(read));
+  REQUIRE(read.lastAzimuth == Approx(900));
+  REQUIRE(read.dirtyBegin == 100);
+  REQUIRE(read.dirtyEnd == 180);
+  REQUIRE(read.frame == 1);
+
+  std::cout << "Test Case 42. Expected: dirty 100 to 180" << ". Outcome: dirty " << read.dirtyBegin << " to " << read.dirtyEnd << std::endl;
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 43 - every spoke index is reachable from the azimuths a radar sends.") {
+  std::vector<uint8_t> bytes(64, 5);
+  SpokeView spoke;
+  spoke.data = bytes.data();
+  spoke.length = uint32_t(bytes.size());
+
+  //Azimuths run 0 to 4095, so with 4096 spokes spoke 0 is north and comes from azimuth 0 only.
+  uint32_t unreached = 0;
+  for (uint16_t spokes : {uint16_t(4096), uint16_t(2048)}) {
+    std::vector<bool> reached(spokes, false);
+    for (uint32_t azimuth = 0; azimuth < 4096; azimuth++) {
+      spoke.azimuth = float(azimuth);
+      int const index = spokeIndex(spoke, spokes, false);
+      REQUIRE(index >= 0);
+      reached[uint32_t(index)] = true;
+    }
+    for (bool r : reached) if (!r) unreached++;
+  }
+  REQUIRE(unreached == 0);
+
+  spoke.azimuth = 0;
+  PolarBuffer polar{4096, 64};
+  REQUIRE(decode(spoke, polar, false) == 0);
+  REQUIRE(polar.dirty(0));
+  REQUIRE(polar.row(0)[63] == 5);
+
+  spoke.azimuth = -1;
+  REQUIRE(spokeIndex(spoke, 4096, false) == -12);
+
+  std::cout << "Test Case 43. Expected: 0 unreached spokes" << ". Outcome: " << unreached << " unreached spokes" << std::endl;
+  std::cout << std::endl;
+}
+
+TEST_CASE("Test 44 - auto skips spokes at the default queue and spoke counts.") {
+  //1024 slots hold half a sweep of 2048 spokes, too few for a newer spoke of the same azimuth to be waiting, so
+  //auto decimates from a quarter full.
+  std::vector<float> sweep;
+  for (uint32_t i = 0; i < 2048; i++) sweep.push_back(float(2 * i));
+  SpokeQueue queue{1024, 8};
+  SpokeThrottle automatic{Overload::Auto, 2048};
+  pushAzimuths(queue, std::vector<float>(sweep.begin(), sweep.begin() + 400));
+  drainAzimuths(queue, automatic);
+  REQUIRE(automatic.stats().decimated > 0);
+  REQUIRE(automatic.stats().coalesced == 0);
+  REQUIRE(automatic.stats().decoded + automatic.stats().decimated == 400);
+
+  //A queue of more than two sweeps skips the spokes of the previous sweep first.
+  SpokeQueue longQueue{8192, 8};
+  SpokeThrottle latest{Overload::Auto, 2048};
+  pushAzimuths(longQueue, sweep);
+  pushAzimuths(longQueue, std::vector<float>(sweep.begin(), sweep.begin() + 100));
+  drainAzimuths(longQueue, latest);
+  REQUIRE(latest.stats().coalesced == 100);
+  REQUIRE(latest.stats().decimated == 0);
+
+  std::cout << "Test Case 44. Expected: decimated at 1024 slots, 100 coalesced at 8192" << ". Outcome: " << automatic.stats().decimated << " decimated, " << latest.stats().coalesced << " coalesced" << std::endl;
+  std::cout << std::endl;
+}